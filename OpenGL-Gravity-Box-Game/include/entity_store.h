@@ -0,0 +1,152 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <new>
+#include <tuple>
+#include <cstddef>
+#include <type_traits>
+
+// Bump allocator for everything that lives exactly as long as one level.
+// Allocation moves a cursor; reset() drops every allocation at once, so
+// nothing allocated here may need a destructor.
+class EntityArena
+{
+public:
+    static const size_t ALIGNMENT = 32; // whole SIMD registers, as in ParticlePool
+
+    EntityArena()
+    {
+        memory = NULL;
+        capacity = used = 0;
+    }
+
+    ~EntityArena()
+    {
+        if (memory)
+            ::operator delete[](memory, std::align_val_t(ALIGNMENT));
+    }
+
+    EntityArena(const EntityArena&) = delete;
+    EntityArena& operator=(const EntityArena&) = delete;
+
+    // forgets every allocation; the block only grows (once) if the next
+    // level needs more than it holds
+    // ------------------------------------------------------------------------
+    void reset(size_t bytesNeeded)
+    {
+        used = 0;
+        if (bytesNeeded <= capacity)
+            return;
+        if (memory)
+            ::operator delete[](memory, std::align_val_t(ALIGNMENT));
+        capacity = bytesNeeded;
+        memory = (char*)::operator new[](capacity, std::align_val_t(ALIGNMENT));
+    }
+    // returns NULL once the block is exhausted
+    // ------------------------------------------------------------------------
+    void* allocate(size_t bytes)
+    {
+        size_t size = roundUp(bytes);
+        if (used + size > capacity)
+            return NULL;
+        void* p = memory + used;
+        used += size;
+        return p;
+    }
+
+    static size_t roundUp(size_t bytes) { return (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+private:
+    char* memory;
+    size_t capacity;
+    size_t used;
+};
+
+// Entities that share one set of components, each component in its own
+// contiguous array (column) carved out of an EntityArena. Live entities are
+// always packed into [0, count): remove() swaps the last one into the hole,
+// so loops over a column never see a dead entity. Entities also keep the id
+// they were created with (0, 1, 2, ... in creation order) for lookups from
+// outside, such as a SpatialGrid built over the initial layout; indexOf()
+// maps an id to its current position, or -1 once it was removed.
+template <typename... Components>
+class Archetype
+{
+    static_assert(std::conjunction<std::is_trivially_copyable<Components>...>::value,
+                  "components live in an arena and are never destroyed");
+
+public:
+    int count;
+    int capacity;
+
+    Archetype()
+    {
+        count = capacity = 0;
+        columns = std::tuple<Components*...>();
+        ids = slots = NULL;
+        nextId = 0;
+    }
+
+    // arena bytes attach() takes for this many entities
+    // ------------------------------------------------------------------------
+    static size_t bytesFor(int capacity)
+    {
+        return (EntityArena::roundUp(capacity * sizeof(Components)) + ...) + 2 * EntityArena::roundUp(capacity * sizeof(int));
+    }
+    // empties the archetype and gives it fresh columns from the arena; the
+    // old ones are simply abandoned with the arena's previous contents
+    // ------------------------------------------------------------------------
+    bool attach(EntityArena& arena, int capacity)
+    {
+        count = 0;
+        nextId = 0;
+        this->capacity = capacity;
+        columns = std::tuple<Components*...>((Components*)arena.allocate(capacity * sizeof(Components))...);
+        ids = (int*)arena.allocate(capacity * sizeof(int));
+        slots = (int*)arena.allocate(capacity * sizeof(int));
+        bool complete = ids && slots && ((std::get<Components*>(columns) != NULL) && ...);
+        if (!complete)
+            this->capacity = 0;
+        return complete;
+    }
+    // returns the new entity's id, or -1 (and drops it) once capacity
+    // entities were created since attach(); ids are never reused
+    // ------------------------------------------------------------------------
+    int create(const Components&... values)
+    {
+        if (nextId >= capacity)
+            return -1;
+        int i = count++, id = nextId++;
+        ((std::get<Components*>(columns)[i] = values), ...);
+        ids[i] = id;
+        slots[id] = i;
+        return id;
+    }
+    // swap-and-pop by id; false if it was already removed
+    // ------------------------------------------------------------------------
+    bool remove(int id)
+    {
+        int i = indexOf(id);
+        if (i < 0)
+            return false;
+        int last = --count;
+        ((std::get<Components*>(columns)[i] = std::get<Components*>(columns)[last]), ...);
+        ids[i] = ids[last];
+        slots[ids[i]] = i;
+        slots[id] = -1;
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    int indexOf(int id) const { return id >= 0 && id < nextId ? slots[id] : -1; }
+    template <typename C> C* column() { return std::get<C*>(columns); }
+    template <typename C> const C* column() const { return std::get<C*>(columns); }
+    template <typename C> C& get(int index) { return std::get<C*>(columns)[index]; }
+
+private:
+    std::tuple<Components*...> columns;
+    int* ids;   // position -> id
+    int* slots; // id -> position, -1 once removed
+    int nextId;
+};
+
+#endif
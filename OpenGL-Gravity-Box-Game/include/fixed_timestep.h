@@ -0,0 +1,58 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+// Turns variable frame times into a whole number of fixed simulation ticks.
+// Frame time is accumulated and drained one tick at a time; what is left
+// over becomes alpha(), the fraction of a tick the renderer should
+// interpolate past the previous state. If a frame would need more than
+// maxSteps ticks the backlog is dropped, so a stall slows the game down
+// for a moment instead of making every following frame slower still.
+class FixedTimestep
+{
+public:
+    float tickRate;   // ticks per second
+    float dt;         // seconds per tick
+    int maxSteps;     // most ticks run for a single frame
+    int droppedFrames; // frames whose backlog hit maxSteps
+
+    FixedTimestep(float tickRate = 120.0f, int maxSteps = 8)
+    {
+        setTickRate(tickRate);
+        this->maxSteps = maxSteps;
+        accumulator = 0.0;
+        droppedFrames = 0;
+    }
+
+    // ------------------------------------------------------------------------
+    void setTickRate(float rate)
+    {
+        tickRate = rate;
+        dt = 1.0f / rate;
+    }
+    // adds one frame's worth of real time and returns how many ticks to run
+    // ------------------------------------------------------------------------
+    int advance(double frameTime)
+    {
+        accumulator += frameTime;
+        int steps = (int)(accumulator / dt);
+        if (steps > maxSteps) {
+            steps = maxSteps;
+            accumulator = 0.0;
+            droppedFrames++;
+        } else {
+            accumulator -= steps * (double)dt;
+        }
+        return steps;
+    }
+    // how far (0..1) the current frame is between the last two ticks
+    // ------------------------------------------------------------------------
+    float alpha() const
+    {
+        return (float)(accumulator / dt);
+    }
+
+private:
+    double accumulator; // double so long sessions do not lose precision
+};
+
+#endif
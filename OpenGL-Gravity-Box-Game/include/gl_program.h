@@ -0,0 +1,150 @@
+#ifndef GL_PROGRAM_H
+#define GL_PROGRAM_H
+
+#include "glad.h"
+
+#include "program_cache.h"
+#include "parallel_shader_compile.h"
+
+#include <string>
+#include <iostream>
+
+// A program submitted to the driver but not yet checked, like a future of
+// its ID. buildProgram() only issues the compile and link calls; nothing
+// asks for a status until get(), so every program can be submitted up
+// front and the driver (on its own threads with KHR_parallel_shader_compile)
+// works while the caller loads meshes and textures. get() then reports
+// errors, stores the binary in the cache and hands out the program.
+// The sources and name must outlive the build; in this tree they are
+// string literals.
+class ProgramBuild
+{
+public:
+    ProgramBuild() : program(0), vertex(0), fragment(0), cache(NULL) {}
+
+    // true when get() will not wait on the driver
+    // ------------------------------------------------------------------------
+    bool ready() const
+    {
+        return !pending() || programBuildFinished(program);
+    }
+    // the linked program (0 for a default-constructed build)
+    // ------------------------------------------------------------------------
+    unsigned int get()
+    {
+        if (!pending())
+            return program;
+        bool compiled = checkStage(vertex, "VERTEX");
+        compiled = checkStage(fragment, "FRAGMENT") && compiled;
+        GLint linked;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            GLchar infoLog[1024];
+            glGetProgramInfoLog(program, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of " << name << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        else if (compiled && cache)
+        {
+            const char* sources[3];
+            int count = cacheKey(sources);
+            cache->store(sources, count, program);
+        }
+        glDeleteShader(vertex);
+        if (fragment)
+            glDeleteShader(fragment);
+        vertex = fragment = 0;
+        return program;
+    }
+
+private:
+    friend ProgramBuild buildProgram(const char*, const char*, const char*, const char**, int);
+
+    unsigned int program;
+    unsigned int vertex, fragment; // 0 once checked, or when loaded from the cache
+    const char* vertexSource;
+    const char* fragmentSource;
+    const char* name;
+    std::string varyings; // transform feedback outputs, part of the link
+    ProgramCache* cache;
+
+    bool pending() const { return vertex != 0; }
+
+    // the strings that decide what the driver builds
+    int cacheKey(const char* sources[3]) const
+    {
+        sources[0] = vertexSource;
+        sources[1] = fragmentSource ? fragmentSource : "";
+        sources[2] = varyings.c_str();
+        return varyings.empty() ? 2 : 3;
+    }
+    bool checkStage(unsigned int shader, const char* stage) const
+    {
+        if (!shader)
+            return true;
+        GLint success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            GLchar infoLog[1024];
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of " << name << " " << stage << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+        return success;
+    }
+};
+
+// submits a program without waiting for it: loads the binary
+// ProgramCache::current holds for these sources, or starts compiling and
+// linking them. fragmentSource may be NULL for a transform feedback
+// program, which names its captured outputs (interleaved) in varyings.
+// ------------------------------------------------------------------------
+inline ProgramBuild buildProgram(const char* vertexSource, const char* fragmentSource, const char* name,
+                                 const char** varyings = NULL, int varyingCount = 0)
+{
+    ProgramBuild build;
+    build.vertexSource = vertexSource;
+    build.fragmentSource = fragmentSource;
+    build.name = name;
+    for (int i = 0; i < varyingCount; i++)
+        build.varyings += std::string(varyings[i]) + " ";
+    build.cache = ProgramCache::current;
+
+    if (build.cache) {
+        const char* sources[3];
+        int count = build.cacheKey(sources);
+        build.program = build.cache->load(sources, count);
+        if (build.program)
+            return build;
+    }
+
+    build.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertex, 1, &vertexSource, NULL);
+    glCompileShader(build.vertex);
+    if (fragmentSource) {
+        build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(build.fragment, 1, &fragmentSource, NULL);
+        glCompileShader(build.fragment);
+    }
+
+    build.program = glCreateProgram();
+    if (build.cache)
+        build.cache->prepare(build.program);
+    glAttachShader(build.program, build.vertex);
+    if (build.fragment)
+        glAttachShader(build.program, build.fragment);
+    if (varyingCount > 0)
+        glTransformFeedbackVaryings(build.program, varyingCount, varyings, GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(build.program);
+    return build;
+}
+
+// links a vertex/fragment pair built from in-memory sources into a
+// program, waiting for it; see buildProgram() to overlap the compile
+// ------------------------------------------------------------------------
+inline unsigned int createProgram(const char* vertexSource, const char* fragmentSource, const char* name)
+{
+    return buildProgram(vertexSource, fragmentSource, name).get();
+}
+
+#endif
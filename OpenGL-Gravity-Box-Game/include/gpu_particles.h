@@ -0,0 +1,228 @@
+#ifndef GPU_PARTICLES_H
+#define GPU_PARTICLES_H
+
+#include "glad.h"
+#include "glm/glm/glm.hpp"
+#include "glm/glm/gtc/type_ptr.hpp"
+
+#include "gl_program.h"
+
+#include <vector>
+#include <iostream>
+
+// Particle record as stored in the GPU buffers. The first two vec4s match
+// SphereInstance, so the buffer is drawn directly as instance data:
+// alpha fades with life and the radius drops to 0 once the particle is dead.
+struct GpuParticle {
+    glm::vec4 posRadius;  // xyz = position, w = size (0 when dead)
+    glm::vec4 colorAlpha; // rgb = color, a = remaining life / 2
+    glm::vec2 vel;
+};
+
+const int GPU_PARTICLE_MAX_EMITS = 16; // emit commands per update pass
+
+// Advances every slot by one step and spawns the particles requested by this
+// frame's emit commands, using the slot index as the random stream.
+static const char* gpuParticleUpdateSource = "#version 330 core\n"
+"layout (location = 0) in vec4 aPosRadius;\n"
+"layout (location = 1) in vec4 aColorAlpha;\n"
+"layout (location = 2) in vec2 aVel;\n"
+"uniform vec2 acceleration;\n"
+"uniform float deltaTime;\n"
+"uniform int emitCount;\n"
+"uniform ivec2 emitRange[16];\n" // first slot, slot count
+"uniform vec3 emitPos[16];\n"
+"uniform vec3 emitColor[16];\n"
+"uniform int emitSeed[16];\n"
+"out vec4 outPosRadius;\n"
+"out vec4 outColorAlpha;\n"
+"out vec2 outVel;\n"
+"uint hash(uint x)\n"
+"{\n"
+"   x ^= x >> 16u; x *= 0x7feb352du;\n"
+"   x ^= x >> 15u; x *= 0x846ca68bu;\n"
+"   return x ^ (x >> 16u);\n"
+"}\n"
+"float random(inout uint state)\n"
+"{\n"
+"   state = hash(state);\n"
+"   return float(state >> 8u) / 16777216.0;\n"
+"}\n"
+"void main()\n"
+"{\n"
+"   int slot = gl_VertexID;\n"
+"   for (int i = 0; i < emitCount; i++) {\n"
+"       if (slot >= emitRange[i].x && slot < emitRange[i].x + emitRange[i].y) {\n"
+"           uint state = uint(slot) * 747796405u + uint(emitSeed[i]);\n"
+"           float angle = random(state) * 6.28;\n"
+"           float speed = random(state) * 1.0 + 0.2;\n"
+"           float life = 1.0 + random(state);\n"
+"           outPosRadius = vec4(emitPos[i], 0.03);\n"
+"           outColorAlpha = vec4(emitColor[i], life * 0.5);\n"
+"           outVel = vec2(cos(angle), sin(angle)) * speed;\n"
+"           return;\n"
+"       }\n"
+"   }\n"
+"   vec2 vel = aVel + acceleration * deltaTime;\n"
+"   float alpha = aColorAlpha.a - 0.5 * deltaTime;\n"
+"   outPosRadius = vec4(aPosRadius.xy + vel * deltaTime, aPosRadius.z, alpha > 0.0 ? aPosRadius.w * 0.98 : 0.0);\n"
+"   outColorAlpha = vec4(aColorAlpha.rgb, alpha);\n"
+"   outVel = vel;\n"
+"}\0";
+
+// Particle backend that keeps all state in two GPU buffers and advances it
+// with a transform-feedback pass (GL 3.3 core, no compute). The CPU only
+// records small emit commands; slots are handed out from a ring, so the
+// oldest (and by then dead) particles are the ones overwritten. Random
+// seeds come from the caller, so the system never touches rand() (which
+// the simulation owns) and a run replays the same wherever it is called.
+class GpuParticleSystem
+{
+public:
+    unsigned int ID;
+    int capacity;
+
+    GpuParticleSystem(int capacity)
+    {
+        this->capacity = capacity;
+        cursor = 0;
+        highWater = 0;
+        emitCount = 0;
+        current = 0;
+
+        // compiles while the buffers are set up
+        const char* varyings[] = { "outPosRadius", "outColorAlpha", "outVel" };
+        ProgramBuild build = buildProgram(gpuParticleUpdateSource, NULL, "GPU_PARTICLE_UPDATE", varyings, 3);
+
+        // slots past highWater are never read, so the buffers start uninitialized
+        glGenBuffers(2, buffers);
+        glGenVertexArrays(2, VAOs);
+        for (int i = 0; i < 2; i++) {
+            glBindVertexArray(VAOs[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(GpuParticle), NULL, GL_DYNAMIC_COPY);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)(4 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(GpuParticle), (void*)(8 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+        }
+        glBindVertexArray(0);
+
+        ID = build.get();
+        accelerationLoc = glGetUniformLocation(ID, "acceleration");
+        deltaTimeLoc = glGetUniformLocation(ID, "deltaTime");
+        emitCountLoc = glGetUniformLocation(ID, "emitCount");
+        emitRangeLoc = glGetUniformLocation(ID, "emitRange");
+        emitPosLoc = glGetUniformLocation(ID, "emitPos");
+        emitColorLoc = glGetUniformLocation(ID, "emitColor");
+        emitSeedLoc = glGetUniformLocation(ID, "emitSeed");
+    }
+
+    ~GpuParticleSystem()
+    {
+        glDeleteVertexArrays(2, VAOs);
+        glDeleteBuffers(2, buffers);
+        glDeleteProgram(ID);
+    }
+
+    // queues count particles bursting out of pos, randomized by seed; they
+    // spawn on the next update(), or a later one if that pass is full
+    // ------------------------------------------------------------------------
+    void emit(const glm::vec3& pos, const glm::vec3& color, int count, int seed)
+    {
+        if (count > capacity) count = capacity;
+        while (count > 0) {
+            if (emitCount == GPU_PARTICLE_MAX_EMITS) {
+                deferred.push_back({ pos, color, count, seed }); // too many bursts this pass
+                return;
+            }
+            // a burst that wraps around the ring becomes two commands
+            int run = count < capacity - cursor ? count : capacity - cursor;
+            emitRange[emitCount] = glm::ivec2(cursor, run);
+            emitPos[emitCount] = pos;
+            emitColor[emitCount] = color;
+            emitSeed[emitCount] = seed;
+            emitCount++;
+
+            cursor += run;
+            if (cursor > highWater) highWater = cursor;
+            if (cursor == capacity) cursor = 0;
+            count -= run;
+        }
+    }
+    // forgets every particle; slots are only read once they have been re-emitted
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        cursor = 0;
+        highWater = 0;
+        emitCount = 0;
+        deferred.clear();
+    }
+    // one transform-feedback pass over every slot that has ever been used
+    // ------------------------------------------------------------------------
+    void update(const glm::vec3& acceleration, float deltaTime)
+    {
+        if (highWater == 0)
+            return;
+
+        glUseProgram(ID);
+        glUniform2f(accelerationLoc, acceleration.x, acceleration.y);
+        glUniform1f(deltaTimeLoc, deltaTime);
+        glUniform1i(emitCountLoc, emitCount);
+        if (emitCount > 0) {
+            glUniform2iv(emitRangeLoc, emitCount, glm::value_ptr(emitRange[0]));
+            glUniform3fv(emitPosLoc, emitCount, glm::value_ptr(emitPos[0]));
+            glUniform3fv(emitColorLoc, emitCount, glm::value_ptr(emitColor[0]));
+            glUniform1iv(emitSeedLoc, emitCount, emitSeed);
+        }
+
+        int next = 1 - current;
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(VAOs[current]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[next]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, highWater);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glDisable(GL_RASTERIZER_DISCARD);
+
+        current = next;
+        emitCount = 0;
+
+        // bursts that did not fit this pass go into the next
+        std::vector<Burst> carried;
+        carried.swap(deferred);
+        for (const Burst& b : carried)
+            emit(b.pos, b.color, b.count, b.seed);
+    }
+    // bursts waiting for a later pass
+    // ------------------------------------------------------------------------
+    int deferredBursts() const { return (int)deferred.size(); }
+    // buffer holding the latest state, laid out as GpuParticle records
+    // ------------------------------------------------------------------------
+    unsigned int stateBuffer() const { return buffers[current]; }
+    // number of slots to draw; dead ones have radius 0 and rasterize nothing
+    int slotCount() const { return highWater; }
+
+private:
+    unsigned int buffers[2], VAOs[2];
+    int current;
+    int cursor, highWater;
+    int emitCount;
+    glm::ivec2 emitRange[GPU_PARTICLE_MAX_EMITS];
+    glm::vec3 emitPos[GPU_PARTICLE_MAX_EMITS];
+    glm::vec3 emitColor[GPU_PARTICLE_MAX_EMITS];
+    int emitSeed[GPU_PARTICLE_MAX_EMITS];
+    struct Burst {
+        glm::vec3 pos, color;
+        int count, seed;
+    };
+    std::vector<Burst> deferred;
+    int accelerationLoc, deltaTimeLoc, emitCountLoc;
+    int emitRangeLoc, emitPosLoc, emitColorLoc, emitSeedLoc;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef HUD_TEXT_H
+#define HUD_TEXT_H
+
+#include "glad.h"
+#include "glm/glm/glm.hpp"
+#ifndef STBI_INCLUDE_STB_IMAGE_H // main.cpp already includes it with the implementation
+#include "stb_image.h"
+#endif
+
+#include "gl_program.h"
+
+#include <vector>
+#include <string>
+#include <iostream>
+
+// Glyph atlas layout: printable ASCII (32..127) in a 16 column grid of
+// HUD_CELL_WIDTH x HUD_CELL_HEIGHT pixel cells, each holding a 5x7 glyph
+const int HUD_CELL_WIDTH = 6;
+const int HUD_CELL_HEIGHT = 8;
+const int HUD_ATLAS_COLUMNS = 16;
+const int HUD_MAX_GLYPHS = 1024;
+
+// One glyph corner, laid out exactly as it is streamed to the GPU
+struct HudVertex {
+    glm::vec2 pos; // pixels, origin top-left
+    glm::vec2 uv;
+    glm::vec4 color;
+};
+
+static const char* hudVertexSource = "#version 330 core\n"
+"layout (location = 0) in vec2 aPos;\n"
+"layout (location = 1) in vec2 aUV;\n"
+"layout (location = 2) in vec4 aColor;\n"
+"uniform vec2 screenSize;\n"
+"out vec2 uv;\n"
+"out vec4 color;\n"
+"void main()\n"
+"{\n"
+"   uv = aUV;\n"
+"   color = aColor;\n"
+"   gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);\n"
+"}\0";
+
+static const char* hudFragmentSource = "#version 330 core\n"
+"in vec2 uv;\n"
+"in vec4 color;\n"
+"uniform sampler2D atlas;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = vec4(color.rgb, color.a * texture(atlas, uv).r);\n"
+"}\0";
+
+// Screen-space text overlay drawn from a baked glyph atlas. The HUD is a
+// fixed set of lines; setLine() only marks the geometry dirty when a line's
+// text or color actually changed, and draw() rebuilds the quads for all
+// lines in that case only. Every glyph goes out in a single draw call.
+class HudText
+{
+public:
+    unsigned int ID;
+    bool loaded;     // false if the atlas could not be read; draw() then does nothing
+    int rebuilds;    // times the glyph geometry was regenerated
+
+    HudText(const char* atlasPath, int screenWidth, int screenHeight, float scale)
+    {
+        this->screenWidth = screenWidth;
+        this->screenHeight = screenHeight;
+        this->scale = scale;
+        rebuilds = 0;
+        glyphCount = 0;
+        dirty = false;
+        ProgramBuild build = buildProgram(hudVertexSource, hudFragmentSource, "HUD"); // compiles while the atlas loads
+
+        int width, height, channels;
+        unsigned char* pixels = stbi_load(atlasPath, &width, &height, &channels, 1);
+        loaded = pixels != NULL;
+        if (!loaded) {
+            std::cout << "ERROR::HUD::FAILED_TO_LOAD_ATLAS " << atlasPath << std::endl;
+            width = height = 1;
+        }
+        atlasSize = glm::vec2((float)width, (float)height);
+        glGenTextures(1, &atlas);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        unsigned char blank = 0;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, loaded ? pixels : &blank);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // pixel font, keep the texels square at any integer scale
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (pixels)
+            stbi_image_free(pixels);
+
+        ID = build.get();
+        glUseProgram(ID);
+        glUniform1i(glGetUniformLocation(ID, "atlas"), 0);
+        screenSizeLoc = glGetUniformLocation(ID, "screenSize");
+
+        // quads share one static index buffer: 0 1 2, 2 1 3 per glyph
+        std::vector<unsigned int> indices(HUD_MAX_GLYPHS * 6);
+        for (int g = 0; g < HUD_MAX_GLYPHS; g++) {
+            unsigned int base = g * 4;
+            unsigned int quad[6] = { base, base + 1, base + 2, base + 2, base + 1, base + 3 };
+            for (int k = 0; k < 6; k++)
+                indices[g * 6 + k] = quad[k];
+        }
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, HUD_MAX_GLYPHS * 4 * sizeof(HudVertex), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+    }
+
+    ~HudText()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteTextures(1, &atlas);
+        glDeleteProgram(ID);
+    }
+
+    // sets the text of one HUD line, counted from the top; cheap when unchanged
+    // ------------------------------------------------------------------------
+    void setLine(int line, const char* text, const glm::vec4& color)
+    {
+        if (line >= (int)lines.size())
+            lines.resize(line + 1);
+        Line& l = lines[line];
+        if (l.text == text && l.color == color)
+            return;
+        l.text = text;
+        l.color = color;
+        dirty = true;
+    }
+    // draws every line on top of the scene in one call
+    // ------------------------------------------------------------------------
+    void draw()
+    {
+        if (!loaded)
+            return;
+        if (dirty)
+            rebuild();
+        if (glyphCount == 0)
+            return;
+
+        glDisable(GL_DEPTH_TEST);
+        glUseProgram(ID);
+        glUniform2f(screenSizeLoc, (float)screenWidth, (float)screenHeight);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, atlas);
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, glyphCount * 6, GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+private:
+    struct Line {
+        std::string text;
+        glm::vec4 color;
+    };
+
+    unsigned int VAO, VBO, EBO, atlas;
+    int screenSizeLoc;
+    int screenWidth, screenHeight;
+    float scale;
+    glm::vec2 atlasSize;
+    std::vector<Line> lines;
+    std::vector<HudVertex> vertices;
+    int glyphCount;
+    bool dirty;
+
+    void rebuild()
+    {
+        const float margin = 8.0f;
+        const float advance = HUD_CELL_WIDTH * scale, lineHeight = (HUD_CELL_HEIGHT + 2) * scale;
+        vertices.clear();
+        glyphCount = 0;
+        for (size_t l = 0; l < lines.size(); l++) {
+            float x = margin, y = margin + l * lineHeight;
+            for (char c : lines[l].text) {
+                if (glyphCount == HUD_MAX_GLYPHS)
+                    break;
+                if (c > ' ' && c < 127)
+                    addGlyph(c, x, y, lines[l].color);
+                x += advance;
+            }
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(HudVertex), vertices.data());
+        dirty = false;
+        rebuilds++;
+    }
+
+    void addGlyph(char c, float x, float y, const glm::vec4& color)
+    {
+        int cell = c - 32;
+        glm::vec2 uv0(cell % HUD_ATLAS_COLUMNS * HUD_CELL_WIDTH, cell / HUD_ATLAS_COLUMNS * HUD_CELL_HEIGHT);
+        glm::vec2 uv1 = uv0 + glm::vec2(HUD_CELL_WIDTH, HUD_CELL_HEIGHT);
+        uv0 /= atlasSize;
+        uv1 /= atlasSize;
+        float w = HUD_CELL_WIDTH * scale, h = HUD_CELL_HEIGHT * scale;
+        vertices.push_back({ glm::vec2(x, y),         glm::vec2(uv0.x, uv0.y), color });
+        vertices.push_back({ glm::vec2(x + w, y),     glm::vec2(uv1.x, uv0.y), color });
+        vertices.push_back({ glm::vec2(x, y + h),     glm::vec2(uv0.x, uv1.y), color });
+        vertices.push_back({ glm::vec2(x + w, y + h), glm::vec2(uv1.x, uv1.y), color });
+        glyphCount++;
+    }
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <iterator>
+
+// Binary input recordings. A run is reproducible from its RNG seed, its tick
+// rate, the settings that shape the simulation (--stress, which changes
+// every level's layout, and the particle backend it started on) and the
+// input of every tick, so that is all a recording holds:
+//
+//   "GBIN" | version u8 | seed u32 | tick rate f32 | stress objects u32 |
+//   particle backend u8   (little-endian)
+//   events: tick delta (LEB128 varint) | input byte
+//   end:    tick delta (varint)        | 0xFF
+//
+// An event is written only on the ticks where the input byte changes, so a
+// minute of play is typically a few hundred bytes. Input byte layout:
+// bits 0-1 moveX + 1, bit 2 flip gravity, bit 3 reset, bit 4 switch backend.
+const unsigned char INPUT_RECORDING_VERSION = 3; // 2: levels laid out by PoissonDisk, 3: settings in the header
+const size_t INPUT_RECORDING_HEADER = 18;
+const unsigned char INPUT_RECORDING_END = 0xFF;
+
+inline unsigned char packInput(int moveX, bool flip, bool reset, bool switchBackend)
+{
+    return (unsigned char)((moveX + 1) | (flip << 2) | (reset << 3) | (switchBackend << 4));
+}
+
+class InputRecorder
+{
+public:
+    bool recording;
+
+    InputRecorder() : recording(false), lastTick(0), lastInput(packInput(0, false, false, false)) {}
+
+    // ------------------------------------------------------------------------
+    bool open(const char* path, uint32_t seed, float tickRate, uint32_t stressObjects, unsigned char particleBackend)
+    {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cout << "ERROR::INPUT_RECORDING::CANNOT_OPEN " << path << std::endl;
+            return false;
+        }
+        file.write("GBIN", 4);
+        file.put((char)INPUT_RECORDING_VERSION);
+        writeRaw(&seed, 4);
+        writeRaw(&tickRate, 4);
+        writeRaw(&stressObjects, 4);
+        file.put((char)particleBackend);
+        recording = true;
+        return true;
+    }
+    // called once per tick with that tick's input; only changes are stored
+    // ------------------------------------------------------------------------
+    void record(uint64_t tick, unsigned char input)
+    {
+        if (!recording || input == lastInput)
+            return;
+        writeVarint(tick - lastTick);
+        file.put((char)input);
+        lastTick = tick;
+        lastInput = input;
+    }
+    // endTick is the number of ticks the run lasted
+    // ------------------------------------------------------------------------
+    void close(uint64_t endTick)
+    {
+        if (!recording)
+            return;
+        writeVarint(endTick - lastTick);
+        file.put((char)INPUT_RECORDING_END);
+        file.close();
+        recording = false;
+    }
+
+private:
+    std::ofstream file;
+    uint64_t lastTick;
+    unsigned char lastInput;
+
+    void writeRaw(const void* data, int bytes)
+    {
+        // the format is little-endian, like every platform this builds for
+        file.write((const char*)data, bytes);
+    }
+    void writeVarint(uint64_t v)
+    {
+        while (v >= 0x80) {
+            file.put((char)(v | 0x80));
+            v >>= 7;
+        }
+        file.put((char)v);
+    }
+};
+
+class InputReplay
+{
+public:
+    uint32_t seed;
+    float tickRate;
+    uint32_t stressObjects;
+    unsigned char particleBackend; // at the first tick
+    uint64_t endTick; // ticks in the recording
+
+    InputReplay() : seed(0), tickRate(0.0f), stressObjects(0), particleBackend(0), endTick(0), next(0),
+                    current(packInput(0, false, false, false)) {}
+
+    // reads the whole recording; false if it is missing or malformed
+    // ------------------------------------------------------------------------
+    bool load(const char* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (data.size() < INPUT_RECORDING_HEADER || memcmp(data.data(), "GBIN", 4) != 0 || data[4] != INPUT_RECORDING_VERSION) {
+            std::cout << "ERROR::INPUT_RECORDING::NOT_A_RECORDING " << path << std::endl;
+            return false;
+        }
+        memcpy(&seed, &data[5], 4);
+        memcpy(&tickRate, &data[9], 4);
+        memcpy(&stressObjects, &data[13], 4);
+        particleBackend = data[17];
+
+        size_t p = INPUT_RECORDING_HEADER;
+        uint64_t tick = 0;
+        while (p < data.size()) {
+            uint64_t delta = 0;
+            int shift = 0;
+            while (p < data.size() && (data[p] & 0x80)) {
+                delta |= (uint64_t)(data[p++] & 0x7F) << shift;
+                shift += 7;
+            }
+            if (p + 1 >= data.size())
+                break;
+            delta |= (uint64_t)data[p++] << shift;
+            tick += delta;
+            unsigned char input = data[p++];
+            if (input == INPUT_RECORDING_END) {
+                endTick = tick;
+                return true;
+            }
+            events.push_back(Event{ tick, input });
+        }
+        std::cout << "ERROR::INPUT_RECORDING::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    // input byte for a tick; ticks must be asked for in increasing order
+    // ------------------------------------------------------------------------
+    unsigned char inputAt(uint64_t tick)
+    {
+        while (next < events.size() && events[next].tick <= tick)
+            current = events[next++].input;
+        return current;
+    }
+    bool finished(uint64_t tick) const { return tick >= endTick; }
+
+private:
+    struct Event {
+        uint64_t tick;
+        unsigned char input;
+    };
+    std::vector<Event> events;
+    size_t next;
+    unsigned char current;
+};
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <type_traits>
+
+// Small work-stealing scheduler with a fixed number of worker threads.
+// Every thread, including the one that owns the JobSystem, has its own job
+// deque: a thread takes jobs from the back of its own deque and, once that
+// is empty, steals from the front of the others. parallelFor() deals its
+// chunks out round-robin and then works on them too until all are done, so
+// a JobSystem with 0 workers simply runs everything inline.
+class JobSystem
+{
+public:
+    int workerCount; // threads besides the caller
+
+    JobSystem(int workerCount)
+    {
+        this->workerCount = workerCount < 0 ? 0 : workerCount;
+        quit = false;
+        queued = 0;
+        for (int i = 0; i <= this->workerCount; i++)
+            queues.push_back(new Queue());
+        for (int i = 1; i <= this->workerCount; i++)
+            threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads)
+            t.join();
+        for (Queue* q : queues)
+            delete q;
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // calls fn(begin, end) over [0, count) in chunks of grain items and
+    // returns once every chunk has run
+    // ------------------------------------------------------------------------
+    template <typename F>
+    void parallelFor(int count, int grain, F&& fn)
+    {
+        if (count <= 0)
+            return;
+        if (grain < 1) grain = 1;
+        if (workerCount == 0 || count <= grain) {
+            fn(0, count);
+            return;
+        }
+
+        typedef typename std::remove_reference<F>::type Fn;
+        std::atomic<int> pending((count + grain - 1) / grain);
+        int chunk = 0;
+        for (int begin = 0; begin < count; begin += grain, chunk++) {
+            Job job;
+            job.run = [](void* context, int b, int e) { (*(Fn*)context)(b, e); };
+            job.context = (void*)&fn;
+            job.begin = begin;
+            job.end = begin + grain < count ? begin + grain : count;
+            job.pending = &pending;
+            push(chunk % (workerCount + 1), job);
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+        }
+        wake.notify_all();
+
+        // help until our chunks are done; whatever is left is being run by a worker
+        int self = threadIndex();
+        while (pending.load(std::memory_order_acquire) > 0) {
+            Job job;
+            if (pop(self, job) || steal(self, job))
+                execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Job {
+        void (*run)(void*, int, int);
+        void* context;
+        int begin, end;
+        std::atomic<int>* pending;
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<Queue*> queues; // [0] belongs to the owning thread
+    std::vector<std::thread> threads;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> queued;
+    bool quit;
+
+    // index of the calling thread's queue; 0 for any thread that is not a worker
+    static int& threadIndex()
+    {
+        static thread_local int index = 0;
+        return index;
+    }
+
+    void push(int q, const Job& job)
+    {
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        queues[q]->jobs.push_back(job);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    bool pop(int q, Job& job)
+    {
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        if (queues[q]->jobs.empty())
+            return false;
+        job = queues[q]->jobs.back();
+        queues[q]->jobs.pop_back();
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    bool steal(int self, Job& job)
+    {
+        for (int i = 1; i <= workerCount; i++) {
+            Queue* victim = queues[(self + i) % (workerCount + 1)];
+            std::lock_guard<std::mutex> guard(victim->lock);
+            if (!victim->jobs.empty()) {
+                job = victim->jobs.front();
+                victim->jobs.pop_front();
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+    void execute(const Job& job)
+    {
+        job.run(job.context, job.begin, job.end);
+        job.pending->fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    void workerLoop(int index)
+    {
+        threadIndex() = index;
+        while (true) {
+            Job job;
+            if (pop(index, job) || steal(index, job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this] { return quit || queued.load(std::memory_order_acquire) > 0; });
+            if (quit)
+                return;
+        }
+    }
+};
+
+#endif
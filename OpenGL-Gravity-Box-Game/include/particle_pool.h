@@ -0,0 +1,207 @@
+#ifndef PARTICLE_POOL_H
+#define PARTICLE_POOL_H
+
+#include "glm/glm/glm.hpp"
+
+#include "job_system.h"
+
+#include <new>
+#include <atomic>
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PARTICLE_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLE_SIMD_WIDTH 4
+#else
+#define PARTICLE_SIMD_WIDTH 1
+#endif
+
+// Fixed-capacity particle storage laid out as structure-of-arrays so the
+// per-frame integration streams through memory and vectorizes. Dead
+// particles are removed with swap-and-pop, so order is not preserved.
+// Gravity Box is played in the z = 0 plane (explosions and gravity never
+// leave it), so particles carry no z and the update touches 25% less memory.
+class ParticlePool
+{
+public:
+    float* posX; float* posY;
+    float* velX; float* velY;
+    float* colorR; float* colorG; float* colorB;
+    float* life;
+    float* size;
+    int count;
+    int capacity;
+
+    ParticlePool(int capacity)
+    {
+        allocate(capacity);
+    }
+
+    ~ParticlePool()
+    {
+        release();
+    }
+
+    ParticlePool(const ParticlePool&) = delete;
+    ParticlePool& operator=(const ParticlePool&) = delete;
+
+    // returns false (and drops the particle) once the pool is full
+    // ------------------------------------------------------------------------
+    bool emit(const glm::vec3& pos, const glm::vec3& vel, const glm::vec3& color, float particleLife, float particleSize)
+    {
+        if (count >= capacity)
+            return false;
+        int i = count++;
+        posX[i] = pos.x;   posY[i] = pos.y;
+        velX[i] = vel.x;   velY[i] = vel.y;
+        colorR[i] = color.r; colorG[i] = color.g; colorB[i] = color.b;
+        life[i] = particleLife;
+        size[i] = particleSize;
+        return true;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        count = 0;
+    }
+    // reallocates for a different capacity; every particle is dropped
+    // ------------------------------------------------------------------------
+    void resize(int newCapacity)
+    {
+        release();
+        allocate(newCapacity);
+    }
+    // ------------------------------------------------------------------------
+    glm::vec3 position(int i) const { return glm::vec3(posX[i], posY[i], 0.0f); }
+    glm::vec3 color(int i) const { return glm::vec3(colorR[i], colorG[i], colorB[i]); }
+
+    // integrates every live particle, then removes the ones that died. With a
+    // job system the integration is split into chunks across its threads;
+    // particles are independent, so the result is the same bit for bit.
+    // ------------------------------------------------------------------------
+    void update(const glm::vec3& acceleration, float deltaTime, JobSystem* jobs = NULL)
+    {
+        glm::vec3 dv = acceleration * deltaTime;
+        bool anyDead;
+        if (jobs && jobs->workerCount > 0 && count > PARTICLE_JOB_GRAIN) {
+            std::atomic<bool> died(false);
+            jobs->parallelFor(count, PARTICLE_JOB_GRAIN, [&](int begin, int end) {
+                if (integrate(begin, end, dv, deltaTime))
+                    died.store(true, std::memory_order_relaxed);
+            });
+            anyDead = died.load();
+        } else {
+            anyDead = integrate(0, count, dv, deltaTime);
+        }
+        if (anyDead)
+            removeDead();
+    }
+
+    // particles per job; a multiple of 8 so every chunk starts SIMD-aligned
+    static const int PARTICLE_JOB_GRAIN = 16384;
+
+private:
+    void allocate(int requested)
+    {
+        // round up so every array is a whole number of SIMD registers
+        capacity = (requested + 7) & ~7;
+        count = 0;
+        float** arrays[] = { &posX, &posY, &velX, &velY, &colorR, &colorG, &colorB, &life, &size };
+        for (float** a : arrays)
+            *a = (float*)::operator new[](capacity * sizeof(float), std::align_val_t(32));
+    }
+    void release()
+    {
+        float* arrays[] = { posX, posY, velX, velY, colorR, colorG, colorB, life, size };
+        for (float* a : arrays)
+            ::operator delete[](a, std::align_val_t(32));
+    }
+
+    // vel += acceleration * dt; pos += vel * dt; life -= dt; size *= 0.98
+    // over [begin, end); returns true if any particle died, so the removal
+    // pass can be skipped
+    bool integrate(int begin, int end, const glm::vec3& dv, float dt)
+    {
+        int i = begin;
+        bool anyDead = false;
+#if PARTICLE_SIMD_WIDTH == 8
+        const __m256 dvx = _mm256_set1_ps(dv.x), dvy = _mm256_set1_ps(dv.y);
+        const __m256 vdt = _mm256_set1_ps(dt), shrink = _mm256_set1_ps(0.98f), zero = _mm256_setzero_ps();
+        __m256 dead = zero;
+        for (; i + 8 <= end; i += 8) {
+            __m256 vx = _mm256_add_ps(_mm256_load_ps(velX + i), dvx);
+            __m256 vy = _mm256_add_ps(_mm256_load_ps(velY + i), dvy);
+            _mm256_store_ps(velX + i, vx);
+            _mm256_store_ps(velY + i, vy);
+            _mm256_store_ps(posX + i, _mm256_add_ps(_mm256_load_ps(posX + i), _mm256_mul_ps(vx, vdt)));
+            _mm256_store_ps(posY + i, _mm256_add_ps(_mm256_load_ps(posY + i), _mm256_mul_ps(vy, vdt)));
+            __m256 l = _mm256_sub_ps(_mm256_load_ps(life + i), vdt);
+            _mm256_store_ps(life + i, l);
+            dead = _mm256_or_ps(dead, _mm256_cmp_ps(l, zero, _CMP_LE_OQ));
+            _mm256_store_ps(size + i, _mm256_mul_ps(_mm256_load_ps(size + i), shrink));
+        }
+        anyDead = _mm256_movemask_ps(dead) != 0;
+#elif PARTICLE_SIMD_WIDTH == 4
+        const __m128 dvx = _mm_set1_ps(dv.x), dvy = _mm_set1_ps(dv.y);
+        const __m128 vdt = _mm_set1_ps(dt), shrink = _mm_set1_ps(0.98f), zero = _mm_setzero_ps();
+        __m128 dead = zero;
+        for (; i + 4 <= end; i += 4) {
+            __m128 vx = _mm_add_ps(_mm_load_ps(velX + i), dvx);
+            __m128 vy = _mm_add_ps(_mm_load_ps(velY + i), dvy);
+            _mm_store_ps(velX + i, vx);
+            _mm_store_ps(velY + i, vy);
+            _mm_store_ps(posX + i, _mm_add_ps(_mm_load_ps(posX + i), _mm_mul_ps(vx, vdt)));
+            _mm_store_ps(posY + i, _mm_add_ps(_mm_load_ps(posY + i), _mm_mul_ps(vy, vdt)));
+            __m128 l = _mm_sub_ps(_mm_load_ps(life + i), vdt);
+            _mm_store_ps(life + i, l);
+            dead = _mm_or_ps(dead, _mm_cmple_ps(l, zero));
+            _mm_store_ps(size + i, _mm_mul_ps(_mm_load_ps(size + i), shrink));
+        }
+        anyDead = _mm_movemask_ps(dead) != 0;
+#endif
+        // scalar fallback and tail
+        for (; i < end; i++) {
+            velX[i] += dv.x; velY[i] += dv.y;
+            posX[i] += velX[i] * dt; posY[i] += velY[i] * dt;
+            life[i] -= dt;
+            anyDead |= life[i] <= 0.0f;
+            size[i] *= 0.98f;
+        }
+        return anyDead;
+    }
+
+    // swap-and-pop every particle whose life ran out
+    void removeDead()
+    {
+        int i = 0;
+        while (i < count) {
+#if PARTICLE_SIMD_WIDTH == 8
+            // skip whole registers of live particles without branching per element
+            if (i + 8 <= count && (i & 7) == 0 && _mm256_movemask_ps(_mm256_cmp_ps(_mm256_load_ps(life + i), _mm256_setzero_ps(), _CMP_LE_OQ)) == 0) {
+                i += 8;
+                continue;
+            }
+#elif PARTICLE_SIMD_WIDTH == 4
+            if (i + 4 <= count && (i & 3) == 0 && _mm_movemask_ps(_mm_cmple_ps(_mm_load_ps(life + i), _mm_setzero_ps())) == 0) {
+                i += 4;
+                continue;
+            }
+#endif
+            if (life[i] <= 0.0f) {
+                int last = --count;
+                posX[i] = posX[last]; posY[i] = posY[last];
+                velX[i] = velX[last]; velY[i] = velY[last];
+                colorR[i] = colorR[last]; colorG[i] = colorG[last]; colorB[i] = colorB[last];
+                life[i] = life[last];
+                size[i] = size[last];
+            } else {
+                i++;
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef POISSON_DISK_H
+#define POISSON_DISK_H
+
+#include "glm/glm/glm.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// xorshift32: tiny, fast and gives the same sequence on every platform and
+// thread, unlike rand(), so a seed alone fixes a generated layout
+struct Xorshift32 {
+    uint32_t state;
+
+    explicit Xorshift32(uint32_t seed) { state = seed ? seed : 0x9E3779B9u; }
+
+    uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    // 0 <= x < 1, from the top 24 bits
+    float uniform() { return (next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+// Blue-noise points in a rectangle, no two closer than `spacing`, after
+// Bridson ("Fast Poisson disk sampling in arbitrary dimensions", 2007) with
+// Roberts' candidate placement: every point, in the order they were
+// accepted, tries `attempts` candidates evenly spaced (from a random start
+// angle) around a circle just outside the spacing and keeps each that
+// fits. Points are visited once each, oldest first, so the work is one
+// linear pass. A background grid of spacing / sqrt(2) cells holds at most
+// one point per cell, with its coordinates, so rejecting a candidate reads
+// one fixed 5x5 block of cells however many points exist.
+class PoissonDisk
+{
+public:
+    std::vector<glm::vec2> points;
+
+    PoissonDisk(glm::vec2 lo, glm::vec2 hi, float spacing)
+    {
+        this->lo = lo;
+        this->hi = hi;
+        this->spacing = spacing;
+        cellSize = spacing / std::sqrt(2.0f);
+        cols = (int)std::ceil((hi.x - lo.x) / cellSize) + 1;
+        rows = (int)std::ceil((hi.y - lo.y) / cellSize) + 1;
+        grid.assign((size_t)cols * rows, glm::vec2(EMPTY));
+    }
+
+    // no point will be generated closer than radius to center
+    // ------------------------------------------------------------------------
+    void keepOut(glm::vec2 center, float radius)
+    {
+        keepOuts.push_back(glm::vec3(center, radius));
+    }
+    // fills the rectangle until no point has room for another neighbor,
+    // starting from one random point; returns how many points it holds
+    // ------------------------------------------------------------------------
+    int generate(Xorshift32& random, int attempts = 8)
+    {
+        // the first point may need a few tries to clear the keep-out areas
+        for (int tries = 0; points.empty() && tries < 1000; tries++) {
+            glm::vec2 p(lo.x + random.uniform() * (hi.x - lo.x), lo.y + random.uniform() * (hi.y - lo.y));
+            if (accepts(p))
+                add(p);
+        }
+
+        const float radius = spacing * 1.0001f; // just outside, so rounding never rejects
+        const float step = 6.2831853f / attempts;
+        const float c = std::cos(step), s = std::sin(step);
+        for (size_t active = 0; active < points.size(); active++) {
+            float angle = random.uniform() * 6.2831853f;
+            glm::vec2 offset = glm::vec2(std::cos(angle), std::sin(angle)) * radius;
+            for (int a = 0; a < attempts; a++) {
+                glm::vec2 p = points[active] + offset;
+                if (accepts(p))
+                    add(p);
+                offset = glm::vec2(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+            }
+        }
+        return (int)points.size();
+    }
+    // reorders the points at random so any prefix of them is spread over
+    // the whole rectangle (generate() grows outwards from its first point)
+    // ------------------------------------------------------------------------
+    void shuffle(Xorshift32& random)
+    {
+        for (int i = (int)points.size() - 1; i > 0; i--)
+            std::swap(points[i], points[random.next() % (i + 1)]);
+    }
+
+    // points a saturated fill puts in an area, about; for picking a spacing
+    // ------------------------------------------------------------------------
+    static float density(float spacing) { return 0.7f / (spacing * spacing); }
+
+private:
+    glm::vec2 lo, hi;
+    float spacing;
+    float cellSize;
+    int cols, rows;
+    std::vector<glm::vec2> grid; // the point in each cell, EMPTY if none
+    std::vector<glm::vec3> keepOuts; // center, radius
+
+    static constexpr float EMPTY = 1e30f; // farther than any spacing from everything
+
+    void add(glm::vec2 p)
+    {
+        points.push_back(p);
+        grid[cellOf(p)] = p;
+    }
+
+    bool accepts(glm::vec2 p) const
+    {
+        if (p.x < lo.x || p.y < lo.y || p.x > hi.x || p.y > hi.y)
+            return false;
+        for (const glm::vec3& k : keepOuts) {
+            glm::vec2 d = p - glm::vec2(k);
+            if (glm::dot(d, d) < k.z * k.z)
+                return false;
+        }
+        // a point in the same cell is always too close; otherwise anything
+        // within spacing lies at most two cells away, and never in the
+        // corners of that 5x5 block
+        int cx = (int)((p.x - lo.x) / cellSize), cy = (int)((p.y - lo.y) / cellSize);
+        if (grid[(size_t)cy * cols + cx].x != EMPTY)
+            return false;
+        int x0 = cx > 2 ? cx - 2 : 0, x1 = cx + 2 < cols ? cx + 2 : cols - 1;
+        int y0 = cy > 2 ? cy - 2 : 0, y1 = cy + 2 < rows ? cy + 2 : rows - 1;
+        float limit = spacing * spacing;
+        for (int y = y0; y <= y1; y++) {
+            const glm::vec2* row = &grid[(size_t)y * cols];
+            bool edge = y == cy - 2 || y == cy + 2;
+            for (int x = x0; x <= x1; x++) {
+                if (edge && (x == cx - 2 || x == cx + 2))
+                    continue;
+                glm::vec2 d = p - row[x];
+                if (d.x * d.x + d.y * d.y < limit)
+                    return false;
+            }
+        }
+        return true;
+    }
+    size_t cellOf(glm::vec2 p) const
+    {
+        return (size_t)((p.y - lo.y) / cellSize) * cols + (size_t)((p.x - lo.x) / cellSize);
+    }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "glad.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+
+const int PROFILER_GPU_FRAMES = 4;        // frames of queries in flight before results are read
+const int PROFILER_GPU_ZONES = 16;        // GPU zones per frame
+const size_t PROFILER_MAX_EVENTS = 1 << 20; // stop recording past this, a few minutes of play
+
+// One finished zone, in microseconds since the profiler was created
+struct ProfileEvent {
+    const char* name; // must be a string literal
+    int track;        // thread index, or PROFILER_GPU_TRACK
+    double start;
+    double duration;
+};
+
+const int PROFILER_GPU_TRACK = 1000;
+
+// Frame profiler with scoped CPU zones from any thread and GL_TIME_ELAPSED
+// zones on the GL thread. GPU queries live in a ring of PROFILER_GPU_FRAMES
+// frames and are read back when their slot comes round again, so results are
+// normally ready and reading them never stalls the pipeline; a slot whose
+// queries are still pending is dropped rather than waited on. Everything is
+// kept in memory and written out as Chrome trace JSON (chrome://tracing,
+// ui.perfetto.dev) plus a per-zone summary on stdout.
+class Profiler
+{
+public:
+    bool gpuTiming; // GPU zones need a GL context; without one they are ignored
+
+    Profiler(bool gpuTiming)
+    {
+        this->gpuTiming = gpuTiming;
+        origin = std::chrono::steady_clock::now();
+        frame = 0;
+        gpuOpen = -1;
+        gpuCursor = 0.0;
+        if (gpuTiming)
+            glGenQueries(PROFILER_GPU_FRAMES * PROFILER_GPU_ZONES, queries);
+        for (int f = 0; f < PROFILER_GPU_FRAMES; f++)
+            gpuFrames[f].count = 0;
+    }
+
+    ~Profiler()
+    {
+        if (gpuTiming)
+            glDeleteQueries(PROFILER_GPU_FRAMES * PROFILER_GPU_ZONES, queries);
+    }
+
+    // microseconds since construction
+    // ------------------------------------------------------------------------
+    double now() const
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+    // names the calling thread's track in the trace
+    // ------------------------------------------------------------------------
+    void nameThread(const char* name)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        trackNames[track()] = name;
+    }
+    // ------------------------------------------------------------------------
+    void record(const char* name, double start, double end)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (events.size() < PROFILER_MAX_EVENTS)
+            events.push_back(ProfileEvent{ name, track(), start, end - start });
+    }
+
+    // GL thread, once per frame before any gpuBegin(): collects the results
+    // of the frame that used this ring slot last
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        if (!gpuTiming)
+            return;
+        frame++;
+        GpuFrame& slot = gpuFrames[frame % PROFILER_GPU_FRAMES];
+        collect(slot, frame % PROFILER_GPU_FRAMES);
+        slot.count = 0;
+    }
+    // GL_TIME_ELAPSED queries cannot nest, so GPU zones follow one another;
+    // returns false (and times nothing) inside another GPU zone
+    // ------------------------------------------------------------------------
+    bool gpuBegin(const char* name)
+    {
+        GpuFrame& slot = gpuFrames[frame % PROFILER_GPU_FRAMES];
+        if (!gpuTiming || gpuOpen >= 0 || slot.count == PROFILER_GPU_ZONES)
+            return false;
+        gpuOpen = slot.count++;
+        slot.names[gpuOpen] = name;
+        slot.submitted[gpuOpen] = now();
+        glBeginQuery(GL_TIME_ELAPSED, queries[(frame % PROFILER_GPU_FRAMES) * PROFILER_GPU_ZONES + gpuOpen]);
+        return true;
+    }
+    void gpuEnd()
+    {
+        if (gpuOpen < 0)
+            return;
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuOpen = -1;
+    }
+
+    // writes every recorded event as Chrome trace JSON; the GPU zones get
+    // their own track, laid end to end after the CPU time they were issued
+    // ------------------------------------------------------------------------
+    bool writeChromeTrace(const char* path)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::PROFILER::CANNOT_WRITE " << path << std::endl;
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        char line[256];
+        for (auto& t : trackNames) {
+            snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", t.first, t.second.c_str());
+            out << line;
+        }
+        snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", PROFILER_GPU_TRACK);
+        out << line;
+        for (const ProfileEvent& e : events) {
+            snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", e.name, e.track, e.start, e.duration);
+            out << line;
+        }
+        out << "\n]}\n";
+        std::cout << "profile: " << events.size() << " zones written to " << path << std::endl;
+        return true;
+    }
+    // average and worst time of every zone, CPU and GPU, on stdout
+    // ------------------------------------------------------------------------
+    void printSummary()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        struct Total { int count; double sum, worst; };
+        std::map<std::string, Total> totals;
+        for (const ProfileEvent& e : events) {
+            std::string key = (e.track == PROFILER_GPU_TRACK ? "gpu " : "cpu ") + std::string(e.name);
+            Total& t = totals[key];
+            t.count++;
+            t.sum += e.duration;
+            if (e.duration > t.worst) t.worst = e.duration;
+        }
+        std::cout << "zone                      count    avg ms    max ms" << std::endl;
+        for (auto& t : totals)
+            printf("%-24s %6d  %8.3f  %8.3f\n", t.first.c_str(), t.second.count, t.second.sum / t.second.count / 1000.0, t.second.worst / 1000.0);
+    }
+
+private:
+    struct GpuFrame {
+        int count;
+        const char* names[PROFILER_GPU_ZONES];
+        double submitted[PROFILER_GPU_ZONES];
+    };
+
+    std::chrono::steady_clock::time_point origin;
+    std::mutex lock;
+    std::vector<ProfileEvent> events;
+    std::map<int, std::string> trackNames;
+    std::map<std::thread::id, int> tracks;
+    unsigned int queries[PROFILER_GPU_FRAMES * PROFILER_GPU_ZONES];
+    GpuFrame gpuFrames[PROFILER_GPU_FRAMES];
+    uint64_t frame;
+    int gpuOpen;
+    double gpuCursor; // end of the last GPU zone placed on the trace
+
+    // small stable index per thread for the trace's tid; call with lock held
+    int track()
+    {
+        auto it = tracks.find(std::this_thread::get_id());
+        if (it != tracks.end())
+            return it->second;
+        int index = (int)tracks.size();
+        tracks[std::this_thread::get_id()] = index;
+        return index;
+    }
+
+    void collect(GpuFrame& slot, int ring)
+    {
+        for (int z = 0; z < slot.count; z++) {
+            unsigned int query = queries[ring * PROFILER_GPU_ZONES + z];
+            GLint available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue; // still in flight after PROFILER_GPU_FRAMES frames; drop it
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            double duration = elapsed / 1000.0;
+            double start = slot.submitted[z] > gpuCursor ? slot.submitted[z] : gpuCursor;
+            gpuCursor = start + duration;
+            std::lock_guard<std::mutex> guard(lock);
+            if (events.size() < PROFILER_MAX_EVENTS)
+                events.push_back(ProfileEvent{ slot.names[z], PROFILER_GPU_TRACK, start, duration });
+        }
+    }
+};
+
+// Times the enclosing scope, or up to end(), as a CPU zone; does nothing
+// without a profiler
+class ProfileZone
+{
+public:
+    ProfileZone(Profiler* profiler, const char* name) : profiler(profiler), name(name)
+    {
+        if (profiler)
+            start = profiler->now();
+    }
+    ~ProfileZone() { end(); }
+
+    void end()
+    {
+        if (profiler)
+            profiler->record(name, start, profiler->now());
+        profiler = NULL;
+    }
+
+private:
+    Profiler* profiler;
+    const char* name;
+    double start;
+};
+
+// Times the enclosing scope, or up to end(), as a GPU zone
+class GpuProfileZone
+{
+public:
+    GpuProfileZone(Profiler* profiler, const char* name) : profiler(profiler)
+    {
+        open = profiler && profiler->gpuBegin(name);
+    }
+    ~GpuProfileZone() { end(); }
+
+    void end()
+    {
+        if (open)
+            profiler->gpuEnd();
+        open = false;
+    }
+
+private:
+    Profiler* profiler;
+    bool open;
+};
+
+#endif
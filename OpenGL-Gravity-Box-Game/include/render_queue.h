@@ -0,0 +1,249 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "glad.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Depends on nothing but glad, so any of the demos can drop it into include/
+
+// Passes are submitted in this order
+enum RenderPass {
+    RENDER_PASS_OPAQUE = 0,      // sorted by state, then front to back
+    RENDER_PASS_TRANSPARENT = 1, // sorted back to front, then by state
+    RENDER_PASS_OVERLAY = 2      // HUD and the like, sorted by state
+};
+
+// A uniform value attached to one draw, copied into the queue
+struct RenderUniform {
+    unsigned int program;
+    int location;
+    GLenum type;     // GL_FLOAT, GL_FLOAT_VEC2/3/4, GL_FLOAT_MAT4 or GL_INT
+    float value[16]; // GL_INT values are stored bit for bit
+};
+
+// Everything the queue needs to issue one draw
+struct DrawCall {
+    unsigned int program;
+    unsigned int vao;
+    GLenum primitive;
+    int first;     // first vertex, or first index when indexed
+    int count;     // vertices or indices
+    int instances; // 1 for a plain draw
+    bool indexed;  // GL_UNSIGNED_INT indices from the VAO's element buffer
+    // per-draw state the key cannot express (e.g. re-pointing instance
+    // attributes), run after the VAO is bound; buffer, offset and stride
+    // are for its use
+    void (*prepare)(const DrawCall& call);
+    unsigned int buffer;
+    size_t offset;
+    int stride;
+    // filled in by the queue
+    int uniformFirst, uniformCount;
+};
+
+// Counters since the last clear(), summed over every submit()
+struct RenderQueueStats {
+    int draws;
+    int programBinds;
+    int vaoBinds;
+    int uniformUploads;
+    int uniformsSkipped; // value already in the program
+};
+
+// Collects a frame's draws, each with a 64-bit sort key, radix-sorts them
+// and submits them in key order, binding a program or VAO only when it
+// changes and uploading a uniform only when its value differs from the one
+// the queue last gave that program. Uniform values stay in a program across
+// frames, so the cache does too: uniforms the queue sets must not be set
+// behind its back, and forgetProgram() must be called before a program is
+// deleted or relinked.
+class RenderQueue
+{
+public:
+    RenderQueueStats stats;
+
+    RenderQueue()
+    {
+        stats = RenderQueueStats();
+        sorted = false;
+    }
+
+    // key layout, from the top bit: pass (2), then program (16), VAO (16)
+    // and depth (24) front to back; transparent draws put depth (24, back to
+    // front) ahead of program and VAO instead. depth is 0 (near) .. 1 (far);
+    // draws with equal keys keep the order they were pushed in.
+    // ------------------------------------------------------------------------
+    static uint64_t makeKey(RenderPass pass, unsigned int program, unsigned int vao, float depth)
+    {
+        if (depth < 0.0f) depth = 0.0f;
+        if (depth > 1.0f) depth = 1.0f;
+        uint64_t d = (uint64_t)(depth * 0xFFFFFF);
+        uint64_t p = program & 0xFFFF, v = vao & 0xFFFF;
+        uint64_t key = (uint64_t)pass << 62;
+        if (pass == RENDER_PASS_TRANSPARENT)
+            return key | (0xFFFFFF - d) << 38 | p << 22 | v << 6;
+        return key | p << 46 | v << 30 | d << 6;
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        draws.clear();
+        keys.clear();
+        uniforms.clear();
+        sorted = false;
+        stats = RenderQueueStats();
+    }
+    // queues a draw; uniform() calls that follow attach to it
+    // ------------------------------------------------------------------------
+    void push(uint64_t key, const DrawCall& call)
+    {
+        draws.push_back(call);
+        draws.back().uniformFirst = (int)uniforms.size();
+        draws.back().uniformCount = 0;
+        keys.push_back(key);
+        sorted = false;
+    }
+    // ------------------------------------------------------------------------
+    void uniform(int location, GLenum type, const void* value)
+    {
+        if (draws.empty() || location < 0)
+            return;
+        RenderUniform u;
+        memset(&u, 0, sizeof(u));
+        u.program = draws.back().program;
+        u.location = location;
+        u.type = type;
+        memcpy(u.value, value, valueSize(type));
+        uniforms.push_back(u);
+        draws.back().uniformCount++;
+    }
+    // ------------------------------------------------------------------------
+    void forgetProgram(unsigned int program)
+    {
+        for (auto it = cache.begin(); it != cache.end(); )
+            it = it->second.program == program ? cache.erase(it) : ++it;
+    }
+    // ------------------------------------------------------------------------
+    int size() const { return (int)draws.size(); }
+
+    // sorts and issues everything queued since clear() in passes first to
+    // last, so a frame can change render targets or blending between passes
+    // by submitting them separately. The queue is sorted once and stays
+    // filled, so a frame can also be submitted again.
+    // ------------------------------------------------------------------------
+    void submit(RenderPass first = RENDER_PASS_OPAQUE, RenderPass last = RENDER_PASS_OVERLAY)
+    {
+        if (!sorted) {
+            sort();
+            sorted = true;
+        }
+        // the program and VAO bound before submit() are unknown
+        unsigned int program = ~0u, vao = ~0u;
+        for (int index : order) {
+            int pass = (int)(keys[index] >> 62);
+            if (pass < first)
+                continue;
+            if (pass > last)
+                break;
+            const DrawCall& d = draws[index];
+            if (d.program != program) {
+                glUseProgram(d.program);
+                program = d.program;
+                stats.programBinds++;
+            }
+            for (int u = d.uniformFirst; u < d.uniformFirst + d.uniformCount; u++)
+                setUniform(uniforms[u]);
+            if (d.vao != vao) {
+                glBindVertexArray(d.vao);
+                vao = d.vao;
+                stats.vaoBinds++;
+            }
+            if (d.prepare)
+                d.prepare(d);
+            if (d.indexed && d.instances > 1)
+                glDrawElementsInstanced(d.primitive, d.count, GL_UNSIGNED_INT, (void*)(d.first * sizeof(unsigned int)), d.instances);
+            else if (d.indexed)
+                glDrawElements(d.primitive, d.count, GL_UNSIGNED_INT, (void*)(d.first * sizeof(unsigned int)));
+            else if (d.instances > 1)
+                glDrawArraysInstanced(d.primitive, d.first, d.count, d.instances);
+            else
+                glDrawArrays(d.primitive, d.first, d.count);
+            stats.draws++;
+        }
+        glBindVertexArray(0);
+    }
+
+private:
+    std::vector<DrawCall> draws;
+    std::vector<uint64_t> keys;
+    std::vector<RenderUniform> uniforms;
+    std::vector<int> order, scratch;
+    bool sorted; // order matches the queued draws
+    std::unordered_map<uint64_t, RenderUniform> cache; // (program, location) -> value in the program
+
+    static size_t valueSize(GLenum type)
+    {
+        switch (type) {
+        case GL_FLOAT_VEC2: return 2 * sizeof(float);
+        case GL_FLOAT_VEC3: return 3 * sizeof(float);
+        case GL_FLOAT_VEC4: return 4 * sizeof(float);
+        case GL_FLOAT_MAT4: return 16 * sizeof(float);
+        default:            return sizeof(float); // GL_FLOAT, GL_INT
+        }
+    }
+
+    void setUniform(const RenderUniform& u)
+    {
+        uint64_t id = (uint64_t)u.program << 32 | (uint32_t)u.location;
+        auto cached = cache.find(id);
+        if (cached != cache.end() && cached->second.type == u.type && memcmp(cached->second.value, u.value, valueSize(u.type)) == 0) {
+            stats.uniformsSkipped++;
+            return;
+        }
+        switch (u.type) {
+        case GL_FLOAT_VEC2: glUniform2fv(u.location, 1, u.value); break;
+        case GL_FLOAT_VEC3: glUniform3fv(u.location, 1, u.value); break;
+        case GL_FLOAT_VEC4: glUniform4fv(u.location, 1, u.value); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(u.location, 1, GL_FALSE, u.value); break;
+        case GL_INT:        glUniform1iv(u.location, 1, (const GLint*)u.value); break;
+        default:            glUniform1fv(u.location, 1, u.value); break;
+        }
+        cache[id] = u;
+        stats.uniformUploads++;
+    }
+
+    // LSD radix sort of draw indices by key, a byte per pass; stable, and
+    // passes over bytes every key shares are skipped
+    void sort()
+    {
+        int n = (int)draws.size();
+        order.resize(n);
+        scratch.resize(n);
+        for (int i = 0; i < n; i++)
+            order[i] = i;
+        for (int shift = 0; shift < 64; shift += 8) {
+            int counts[257] = { 0 };
+            for (int i = 0; i < n; i++)
+                counts[((keys[i] >> shift) & 0xFF) + 1]++;
+            bool trivial = false;
+            for (int b = 1; b <= 256; b++)
+                trivial |= counts[b] == n;
+            if (trivial)
+                continue;
+            for (int b = 0; b < 256; b++)
+                counts[b + 1] += counts[b];
+            for (int i = 0; i < n; i++) {
+                int index = order[i];
+                scratch[counts[(keys[index] >> shift) & 0xFF]++] = index;
+            }
+            order.swap(scratch);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,120 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "glm/glm/glm.hpp"
+
+#include <vector>
+#include <algorithm>
+
+// Uniform grid broadphase for static objects in the z = 0 plane. Objects are
+// bucketed by center into cells at least one object diameter wide, stored
+// as one flat index array (cellStart[c] .. cellStart[c + 1]). A query only
+// visits the few cells its circle, grown by the largest object radius, can
+// reach, so its cost does not depend on how many objects the level holds.
+class SpatialGrid
+{
+public:
+    SpatialGrid()
+    {
+        cols = rows = 0;
+        cellSize = 1.0f;
+        maxRadius = 0.0f;
+    }
+
+    // objects need .pos and .radius; rebuild whenever the set changes
+    // ------------------------------------------------------------------------
+    template <typename T>
+    void build(const std::vector<T>& objects)
+    {
+        build(objects.data(), (int)objects.size());
+    }
+    // same over a plain array, such as an Archetype column
+    // ------------------------------------------------------------------------
+    template <typename T>
+    void build(const T* objects, int count)
+    {
+        cellStart.clear();
+        items.clear();
+        cols = rows = 0;
+        if (count <= 0)
+            return;
+
+        glm::vec2 lo(objects[0].pos), hi(objects[0].pos);
+        maxRadius = 0.0f;
+        for (int i = 0; i < count; i++) {
+            lo = glm::min(lo, glm::vec2(objects[i].pos));
+            hi = glm::max(hi, glm::vec2(objects[i].pos));
+            maxRadius = std::max(maxRadius, objects[i].radius);
+        }
+
+        // cells one diameter wide, but never more than maxCells per side
+        const int maxCells = 1024;
+        glm::vec2 extent = hi - lo;
+        cellSize = std::max(2.0f * maxRadius, std::max(extent.x, extent.y) / maxCells);
+        if (cellSize <= 0.0f) cellSize = 1.0f;
+        origin = lo;
+        cols = (int)(extent.x / cellSize) + 1;
+        rows = (int)(extent.y / cellSize) + 1;
+
+        // counting sort of object indices by cell
+        cellStart.assign(cols * rows + 1, 0);
+        std::vector<int> cellOf(count);
+        for (int i = 0; i < count; i++) {
+            cellOf[i] = cellIndex(cellCoord(objects[i].pos.x, origin.x, cols), cellCoord(objects[i].pos.y, origin.y, rows));
+            cellStart[cellOf[i] + 1]++;
+        }
+        for (int c = 0; c < cols * rows; c++)
+            cellStart[c + 1] += cellStart[c];
+        items.resize(count);
+        std::vector<int> cursor(cellStart.begin(), cellStart.end() - 1);
+        for (int i = 0; i < count; i++)
+            items[cursor[cellOf[i]]++] = i;
+    }
+
+    // calls visit(index) for every object whose cell the circle can reach;
+    // visit returns true to stop early. Callers still do the exact test.
+    // ------------------------------------------------------------------------
+    template <typename F>
+    void query(const glm::vec3& pos, float radius, F visit) const
+    {
+        querySwept(pos, pos, radius, visit);
+    }
+    // same for every cell a circle moving from `from` to `to` can reach
+    // ------------------------------------------------------------------------
+    template <typename F>
+    void querySwept(const glm::vec3& from, const glm::vec3& to, float radius, F visit) const
+    {
+        if (cols == 0)
+            return;
+        float reach = radius + maxRadius;
+        glm::vec2 lo = glm::min(glm::vec2(from), glm::vec2(to)) - reach;
+        glm::vec2 hi = glm::max(glm::vec2(from), glm::vec2(to)) + reach;
+        int x0 = cellCoord(lo.x, origin.x, cols), x1 = cellCoord(hi.x, origin.x, cols);
+        int y0 = cellCoord(lo.y, origin.y, rows), y1 = cellCoord(hi.y, origin.y, rows);
+        for (int y = y0; y <= y1; y++) {
+            for (int x = x0; x <= x1; x++) {
+                int c = cellIndex(x, y);
+                for (int i = cellStart[c]; i < cellStart[c + 1]; i++)
+                    if (visit(items[i]))
+                        return;
+            }
+        }
+    }
+
+private:
+    glm::vec2 origin;
+    float cellSize;
+    float maxRadius;
+    int cols, rows;
+    std::vector<int> cellStart;
+    std::vector<int> items;
+
+    int cellCoord(float v, float start, int count) const
+    {
+        int c = (int)((v - start) / cellSize);
+        return c < 0 ? 0 : (c >= count ? count - 1 : c);
+    }
+    int cellIndex(int x, int y) const { return y * cols + x; }
+};
+
+#endif
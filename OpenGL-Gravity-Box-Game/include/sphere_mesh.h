@@ -0,0 +1,190 @@
+#ifndef SPHERE_MESH_H
+#define SPHERE_MESH_H
+
+#include <vector>
+#include <cmath>
+
+// One level of detail inside the shared sphere vertex/index buffers
+struct SphereLod {
+    int rings;
+    int segments;
+    int firstIndex;      // offset into SphereMesh::indices
+    int indexCount;
+    int vertexCount;
+    float maxScreenRadius; // used while the projected radius (pixels) is below this
+};
+
+// Reorders a triangle list for post-transform vertex cache reuse using Tom
+// Forsyth's "linear-speed vertex cache optimisation" scoring.
+// ------------------------------------------------------------------------
+inline void optimizeVertexCache(unsigned int* indices, int indexCount, int vertexCount)
+{
+    const int cacheSize = 32;
+    const int triCount = indexCount / 3;
+
+    struct VertexData {
+        int cachePos;
+        int remaining;
+        float score;
+        std::vector<int> tris;
+    };
+    std::vector<VertexData> verts(vertexCount);
+    for (auto& v : verts) { v.cachePos = -1; v.remaining = 0; v.score = 0.0f; }
+    for (int t = 0; t < triCount; t++)
+        for (int k = 0; k < 3; k++)
+            verts[indices[t * 3 + k]].tris.push_back(t);
+    for (auto& v : verts) v.remaining = (int)v.tris.size();
+
+    auto vertexScore = [&](const VertexData& v) {
+        if (v.remaining == 0) return -1.0f;
+        float score = 0.0f;
+        if (v.cachePos >= 0) {
+            if (v.cachePos < 3) score = 0.75f; // the last triangle's vertices
+            else score = powf(1.0f - (float)(v.cachePos - 3) / (cacheSize - 3), 1.5f);
+        }
+        return score + 2.0f * powf((float)v.remaining, -0.5f);
+    };
+    for (auto& v : verts) v.score = vertexScore(v);
+
+    std::vector<float> triScore(triCount);
+    std::vector<bool> triAdded(triCount, false);
+    for (int t = 0; t < triCount; t++)
+        triScore[t] = verts[indices[t * 3]].score + verts[indices[t * 3 + 1]].score + verts[indices[t * 3 + 2]].score;
+
+    std::vector<unsigned int> output;
+    output.reserve(indexCount);
+    std::vector<int> cache;
+    int scanStart = 0;
+
+    for (int added = 0; added < triCount; added++) {
+        // best triangle touching the cache, or the best remaining one if the cache is cold
+        int best = -1;
+        float bestScore = -1.0f;
+        for (int c : cache)
+            for (int t : verts[c].tris)
+                if (!triAdded[t] && triScore[t] > bestScore) { best = t; bestScore = triScore[t]; }
+        if (best < 0) {
+            while (triAdded[scanStart]) scanStart++;
+            for (int t = scanStart; t < triCount; t++)
+                if (!triAdded[t] && triScore[t] > bestScore) { best = t; bestScore = triScore[t]; }
+        }
+
+        triAdded[best] = true;
+        std::vector<int> newCache;
+        for (int k = 0; k < 3; k++) {
+            unsigned int v = indices[best * 3 + k];
+            output.push_back(v);
+            verts[v].remaining--;
+            newCache.push_back((int)v);
+        }
+        for (int c : cache)
+            if (c != newCache[0] && c != newCache[1] && c != newCache[2])
+                newCache.push_back(c);
+
+        // evicted vertices lose their cache bonus
+        for (size_t i = cacheSize; i < newCache.size(); i++)
+            verts[newCache[i]].cachePos = -1;
+        if ((int)newCache.size() > cacheSize) newCache.resize(cacheSize);
+        for (size_t i = 0; i < newCache.size(); i++)
+            verts[newCache[i]].cachePos = (int)i;
+
+        for (int c : cache) verts[c].score = vertexScore(verts[c]);
+        for (int c : newCache) verts[c].score = vertexScore(verts[c]);
+        for (int c : newCache)
+            for (int t : verts[c].tris)
+                if (!triAdded[t])
+                    triScore[t] = verts[indices[t * 3]].score + verts[indices[t * 3 + 1]].score + verts[indices[t * 3 + 2]].score;
+        cache.swap(newCache);
+    }
+
+    for (int i = 0; i < indexCount; i++) indices[i] = output[i];
+}
+
+// Unit spheres at several levels of detail, sharing one vertex array (xyz)
+// and one index array. Vertices are shared between neighbouring triangles
+// and the poles are a single vertex each.
+class SphereMesh
+{
+public:
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<SphereLod> lods;
+
+    SphereMesh()
+    {
+        // { rings, segments, max projected radius in pixels }
+        addLod(3,  6,  4.0f);
+        addLod(5,  8,  10.0f);
+        addLod(8,  12, 24.0f);
+        addLod(12, 20, 64.0f);
+        addLod(20, 32, 1e9f);
+    }
+
+    // picks the cheapest level that still looks round at this pixel radius
+    // ------------------------------------------------------------------------
+    int selectLod(float screenRadius) const
+    {
+        for (size_t i = 0; i < lods.size(); i++)
+            if (screenRadius < lods[i].maxScreenRadius)
+                return (int)i;
+        return (int)lods.size() - 1;
+    }
+
+private:
+    void addLod(int rings, int segments, float maxScreenRadius)
+    {
+        SphereLod lod;
+        lod.rings = rings;
+        lod.segments = segments;
+        lod.firstIndex = (int)indices.size();
+        lod.maxScreenRadius = maxScreenRadius;
+
+        unsigned int base = (unsigned int)(vertices.size() / 3);
+        // north pole, (rings - 1) rings of segments, south pole
+        pushVertex(0.0f, 1.0f, 0.0f);
+        for (int i = 1; i < rings; i++) {
+            float theta = i * 3.14159265f / rings;
+            for (int j = 0; j < segments; j++) {
+                float phi = j * 2.0f * 3.14159265f / segments;
+                pushVertex(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            }
+        }
+        pushVertex(0.0f, -1.0f, 0.0f);
+        lod.vertexCount = 2 + (rings - 1) * segments;
+
+        unsigned int south = lod.vertexCount - 1;
+        auto ringVertex = [segments](int ring, int j) {
+            return (unsigned int)(1 + (ring - 1) * segments + (j % segments));
+        };
+        std::vector<unsigned int> local;
+        for (int j = 0; j < segments; j++) {
+            local.push_back(0); local.push_back(ringVertex(1, j + 1)); local.push_back(ringVertex(1, j));
+        }
+        for (int i = 1; i < rings - 1; i++) {
+            for (int j = 0; j < segments; j++) {
+                unsigned int a = ringVertex(i, j),     b = ringVertex(i, j + 1);
+                unsigned int c = ringVertex(i + 1, j), d = ringVertex(i + 1, j + 1);
+                local.push_back(a); local.push_back(b); local.push_back(c);
+                local.push_back(b); local.push_back(d); local.push_back(c);
+            }
+        }
+        for (int j = 0; j < segments; j++) {
+            local.push_back(south); local.push_back(ringVertex(rings - 1, j)); local.push_back(ringVertex(rings - 1, j + 1));
+        }
+
+        optimizeVertexCache(local.data(), (int)local.size(), lod.vertexCount);
+        for (unsigned int index : local)
+            indices.push_back(base + index);
+        lod.indexCount = (int)local.size();
+        lods.push_back(lod);
+    }
+
+    void pushVertex(float x, float y, float z)
+    {
+        vertices.push_back(x);
+        vertices.push_back(y);
+        vertices.push_back(z);
+    }
+};
+
+#endif
@@ -0,0 +1,606 @@
+#ifndef SPHERE_RENDERER_H
+#define SPHERE_RENDERER_H
+
+#include "glad.h"
+#include "glm/glm/glm.hpp"
+#include "glm/glm/gtc/type_ptr.hpp"
+
+#include "gl_program.h"
+#include "sphere_mesh.h"
+#include "stream_buffer.h"
+#include "render_queue.h"
+#include "weighted_oit.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Per-instance data, laid out exactly as it is streamed to the GPU
+struct SphereInstance {
+    glm::vec3 pos;
+    float radius;
+    glm::vec3 color;
+    float alpha;
+};
+
+// How a batch of spheres is rasterized
+enum SphereDrawMode {
+    SPHERE_MESH,     // tessellated LOD mesh
+    SPHERE_IMPOSTOR  // camera-facing quad, ray-sphere hit in the fragment shader
+};
+
+// How batches flushed into RENDER_PASS_TRANSPARENT are composited
+enum TransparencyMode {
+    TRANSPARENCY_UNSORTED, // in whatever order they were added
+    TRANSPARENCY_SORTED,   // sorted back to front on the CPU, one draw
+    TRANSPARENCY_WEIGHTED  // weighted blended OIT; needs WeightedBlendedOIT targets bound
+};
+
+// A sphere that stays put for a whole level, baked once with bakeStatic().
+// Its radius pulses on the GPU:
+// radius * (1 + amplitude * cos((phase + time) * rate)).
+struct StaticSphere {
+    glm::vec3 pos;
+    float radius;
+    glm::vec3 color;
+    float alpha;
+    float phase;
+    float rate;
+    float amplitude;
+    float padding; // keeps records 16-byte aligned
+};
+
+// Counters for the current frame, reset by beginFrame()
+struct RenderStats {
+    int drawCalls;
+    int uniformUploads;
+    int instances;
+    int vertices; // sphere vertices submitted, summed over all LODs and impostor quads
+};
+
+static const char* sphereInstanceVertexSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"layout (location = 1) in vec4 aPosRadius;\n"  // xyz = center, w = radius
+"layout (location = 2) in vec4 aColorAlpha;\n" // rgb = color, a = alpha
+"uniform mat4 viewProjection;\n"
+"out vec4 sphereColor;\n"
+"void main()\n"
+"{\n"
+"   sphereColor = aColorAlpha;\n"
+"   gl_Position = viewProjection * vec4(aPosRadius.xyz + aPos * aPosRadius.w, 1.0);\n"
+"}\0";
+
+static const char* sphereStaticVertexSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"layout (location = 1) in vec4 aPosRadius;\n"
+"layout (location = 2) in vec4 aColorAlpha;\n"
+"layout (location = 3) in vec3 aPulse;\n"     // phase, rate, amplitude
+"uniform mat4 viewProjection;\n"
+"uniform float time;\n"
+"out vec4 sphereColor;\n"
+"void main()\n"
+"{\n"
+"   float radius = aPosRadius.w * (1.0 + aPulse.z * cos((aPulse.x + time) * aPulse.y));\n"
+"   sphereColor = aColorAlpha;\n"
+"   gl_Position = viewProjection * vec4(aPosRadius.xyz + aPos * radius, 1.0);\n"
+"}\0";
+
+static const char* sphereInstanceFragmentSource = "#version 330 core\n"
+"in vec4 sphereColor;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   FragColor = sphereColor;\n"
+"}\0";
+
+static const char* sphereOitFragmentSource = "#version 330 core\n"
+"in vec4 sphereColor;\n"
+OIT_FRAGMENT_OUTPUTS
+"void main()\n"
+"{\n"
+"   oitWrite(sphereColor.rgb, sphereColor.a, gl_FragCoord.z);\n"
+"}\0";
+
+// The quad is centered on the sphere, faces the camera and is grown so the
+// perspective silhouette (not just the radius) is always covered.
+static const char* sphereImpostorVertexSource = "#version 330 core\n"
+"layout (location = 0) in vec2 aCorner;\n"
+"layout (location = 1) in vec4 aPosRadius;\n"
+"layout (location = 2) in vec4 aColorAlpha;\n"
+"uniform mat4 view;\n"
+"uniform mat4 projection;\n"
+"out vec4 sphereColor;\n"
+"out vec3 viewPos;\n"
+"flat out vec4 sphereView;\n" // view-space center + radius
+"void main()\n"
+"{\n"
+"   vec3 center = (view * vec4(aPosRadius.xyz, 1.0)).xyz;\n"
+"   float r = aPosRadius.w;\n"
+"   float d = length(center);\n"
+"   vec3 toCamera = -center / d;\n"
+"   vec3 right = normalize(cross(abs(toCamera.y) > 0.999 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0), toCamera));\n"
+"   vec3 up = cross(toCamera, right);\n"
+"   float grow = d / sqrt(max(d * d - r * r, 1e-6));\n"
+"   viewPos = center + (right * aCorner.x + up * aCorner.y) * r * grow;\n"
+"   sphereView = vec4(center, r);\n"
+"   sphereColor = aColorAlpha;\n"
+"   gl_Position = projection * vec4(viewPos, 1.0);\n"
+"}\0";
+
+static const char* sphereImpostorFragmentSource = "#version 330 core\n"
+"in vec4 sphereColor;\n"
+"in vec3 viewPos;\n"
+"flat in vec4 sphereView;\n"
+"uniform mat4 projection;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   vec3 dir = normalize(viewPos);\n"
+"   float b = dot(dir, sphereView.xyz);\n"
+"   float c = dot(sphereView.xyz, sphereView.xyz) - sphereView.w * sphereView.w;\n"
+"   float h = b * b - c;\n"
+"   if (h < 0.0) discard;\n"
+"   vec4 clip = projection * vec4(dir * (b - sqrt(h)), 1.0);\n"
+"   gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;\n"
+"   FragColor = sphereColor;\n"
+"}\0";
+
+static const char* sphereImpostorOitFragmentSource = "#version 330 core\n"
+"in vec4 sphereColor;\n"
+"in vec3 viewPos;\n"
+"flat in vec4 sphereView;\n"
+"uniform mat4 projection;\n"
+OIT_FRAGMENT_OUTPUTS
+"void main()\n"
+"{\n"
+"   vec3 dir = normalize(viewPos);\n"
+"   float b = dot(dir, sphereView.xyz);\n"
+"   float c = dot(sphereView.xyz, sphereView.xyz) - sphereView.w * sphereView.w;\n"
+"   float h = b * b - c;\n"
+"   if (h < 0.0) discard;\n"
+"   vec4 clip = projection * vec4(dir * (b - sqrt(h)), 1.0);\n"
+"   float depth = clip.z / clip.w * 0.5 + 0.5;\n"
+"   gl_FragDepth = depth;\n" // still tested against the opaque scene
+"   oitWrite(sphereColor.rgb, sphereColor.a, depth);\n"
+"}\0";
+
+// Collects spheres into a per-instance buffer and draws each batch with one
+// glDrawElementsInstanced call per level of detail in use, instead of one
+// draw (and five uniform uploads) per sphere. The LOD is chosen per instance
+// from its projected radius in pixels. Batches can instead be drawn as ray-cast
+// impostors, one quad per sphere, which suits tiny and numerous particles.
+// Transparent batches follow `transparency`: as added, depth-sorted on the
+// CPU, or through the weighted blended OIT programs.
+class SphereRenderer
+{
+public:
+    unsigned int ID;
+    RenderStats stats;
+    TransparencyMode transparency;
+
+    SphereRenderer(bool persistentStreaming = true) : stream(64 * 1024, persistentStreaming)
+    {
+        // all five compile at once, while the meshes and buffers are set up
+        ProgramBuild builds[5] = {
+            buildProgram(sphereInstanceVertexSource, sphereInstanceFragmentSource, "SPHERE_INSTANCED"),
+            buildProgram(sphereImpostorVertexSource, sphereImpostorFragmentSource, "SPHERE_IMPOSTOR"),
+            buildProgram(sphereStaticVertexSource, sphereInstanceFragmentSource, "SPHERE_STATIC"),
+            buildProgram(sphereInstanceVertexSource, sphereOitFragmentSource, "SPHERE_OIT"),
+            buildProgram(sphereImpostorVertexSource, sphereImpostorOitFragmentSource, "SPHERE_IMPOSTOR_OIT"),
+        };
+
+        staticCount = 0;
+        staticLod = 0;
+        stats = RenderStats();
+        transparency = TRANSPARENCY_UNSORTED;
+
+        glGenVertexArrays(1, &VAO);
+        glGenVertexArrays(1, &impostorVAO);
+        glGenBuffers(1, &meshVBO);
+        glGenBuffers(1, &meshEBO);
+        glGenBuffers(1, &quadVBO);
+        glBindVertexArray(VAO);
+
+        // unit spheres for every LOD, shared by every instance
+        glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // per-instance center/radius and color/alpha, advanced once per instance
+        glBindBuffer(GL_ARRAY_BUFFER, stream.ID);
+        enableInstanceAttributes();
+
+        // impostors: one strip quad per instance, same instance layout
+        float quad[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+        glBindVertexArray(impostorVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, stream.ID);
+        enableInstanceAttributes();
+
+        // static spheres: the LOD mesh again, with their own baked instances
+        glGenVertexArrays(1, &staticVAO);
+        glGenBuffers(1, &staticVBO);
+        glBindVertexArray(staticVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, meshVBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshEBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        pointInstanceAttributes(0, sizeof(StaticSphere));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(StaticSphere), (void*)(8 * sizeof(float)));
+        for (int a = 1; a <= 3; a++) {
+            glEnableVertexAttribArray(a);
+            glVertexAttribDivisor(a, 1);
+        }
+
+        glBindVertexArray(0);
+
+        ID = builds[0].get();
+        viewProjectionLoc = glGetUniformLocation(ID, "viewProjection");
+        impostorID = builds[1].get();
+        impostorViewLoc = glGetUniformLocation(impostorID, "view");
+        impostorProjectionLoc = glGetUniformLocation(impostorID, "projection");
+        staticID = builds[2].get();
+        staticViewProjectionLoc = glGetUniformLocation(staticID, "viewProjection");
+        staticTimeLoc = glGetUniformLocation(staticID, "time");
+        oitID = builds[3].get();
+        oitViewProjectionLoc = glGetUniformLocation(oitID, "viewProjection");
+        impostorOitID = builds[4].get();
+        impostorOitViewLoc = glGetUniformLocation(impostorOitID, "view");
+        impostorOitProjectionLoc = glGetUniformLocation(impostorOitID, "projection");
+    }
+
+    ~SphereRenderer()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteVertexArrays(1, &impostorVAO);
+        glDeleteBuffers(1, &meshVBO);
+        glDeleteBuffers(1, &meshEBO);
+        glDeleteBuffers(1, &quadVBO);
+        glDeleteVertexArrays(1, &staticVAO);
+        glDeleteBuffers(1, &staticVBO);
+        glDeleteProgram(ID);
+        glDeleteProgram(impostorID);
+        glDeleteProgram(staticID);
+        glDeleteProgram(oitID);
+        glDeleteProgram(impostorOitID);
+    }
+
+    // resets the frame counters, moves the instance stream on to a region the
+    // GPU is done with and takes the camera. Each program gets it with its
+    // first draw: through the queue, which skips it while it is unchanged,
+    // or without one uploaded directly, once a frame.
+    // ------------------------------------------------------------------------
+    void beginFrame(const glm::mat4& view, const glm::mat4& projection, int viewportHeight)
+    {
+        stats = RenderStats();
+        stream.beginFrame();
+        this->view = view;
+        this->projection = projection;
+        viewProjection = projection * view;
+        pixelsPerUnit = projection[1][1] * viewportHeight * 0.5f;
+        // clip planes of a glm::perspective projection
+        nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+        farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+        cameraSet.clear();
+    }
+    // replaces the static spheres, e.g. when a level spawns. They all share
+    // one LOD, picked for the largest of them at full pulse (call after
+    // beginFrame(), which sets the camera), so drawStatic() is one call.
+    // ------------------------------------------------------------------------
+    void bakeStatic(const std::vector<StaticSphere>& spheres)
+    {
+        float largest = 0.0f;
+        for (const StaticSphere& s : spheres)
+            largest = std::max(largest, screenRadius(s.pos, s.radius * (1.0f + std::fabs(s.amplitude))));
+        staticLod = mesh.selectLod(largest);
+        staticCount = (int)spheres.size();
+        staticCenter = glm::vec3(0.0f);
+        for (const StaticSphere& s : spheres)
+            staticCenter += s.pos / (float)staticCount;
+        glBindBuffer(GL_ARRAY_BUFFER, staticVBO);
+        glBufferData(GL_ARRAY_BUFFER, spheres.size() * sizeof(StaticSphere), spheres.data(), GL_STATIC_DRAW);
+    }
+    // every baked sphere in one instanced draw, pulsed to the given time
+    // ------------------------------------------------------------------------
+    void drawStatic(float time, RenderQueue* queue = NULL, RenderPass pass = RENDER_PASS_OPAQUE)
+    {
+        if (staticCount == 0)
+            return;
+        const SphereLod& lod = mesh.lods[staticLod];
+        DrawCall d = instancedDraw(staticID, staticVAO, GL_TRIANGLES, lod.firstIndex, lod.indexCount, true, 0, 0, 0, staticCount);
+        d.prepare = NULL; // the instances never move, the VAO already points at them
+        stats.vertices += lod.vertexCount * staticCount;
+        stats.instances += staticCount;
+        if (queue) {
+            issue(queue, pass, d, drawDepth(staticCenter));
+            queue->uniform(staticTimeLoc, GL_FLOAT, &time);
+        } else {
+            glUseProgram(staticID);
+            glUniform1f(staticTimeLoc, time);
+            stats.uniformUploads++;
+            issue(NULL, pass, d, 0.0f);
+        }
+    }
+    // ------------------------------------------------------------------------
+    void add(const glm::vec3& pos, float radius, const glm::vec3& color, float alpha)
+    {
+        SphereInstance instance;
+        instance.pos = pos;
+        instance.radius = radius;
+        instance.color = color;
+        instance.alpha = alpha;
+        batch.push_back(instance);
+    }
+    // projected radius in pixels, from the view-space depth of the center
+    // ------------------------------------------------------------------------
+    float screenRadius(const glm::vec3& pos, float radius) const
+    {
+        float depth = -(view * glm::vec4(pos, 1.0f)).z;
+        if (depth <= 0.0f)
+            return 0.0f;
+        return radius * pixelsPerUnit / depth;
+    }
+    // instance bytes streamed, fence waits and so on this frame
+    // ------------------------------------------------------------------------
+    const StreamStats& streamStats() const { return stream.stats; }
+    bool persistentStreaming() const { return stream.persistent; }
+    // draws everything queued since the last flush, one instanced call per LOD
+    // (mesh) or a single instanced quad draw (impostor). With a render queue
+    // the draws are queued in the given pass instead of issued now.
+    // ------------------------------------------------------------------------
+    void flush(SphereDrawMode mode = SPHERE_MESH, RenderQueue* queue = NULL, RenderPass pass = RENDER_PASS_OPAQUE)
+    {
+        if (batch.empty())
+            return;
+
+        if (pass == RENDER_PASS_TRANSPARENT && transparency == TRANSPARENCY_SORTED) {
+            flushSorted(mode, queue);
+            return;
+        }
+
+        if (mode == SPHERE_IMPOSTOR) {
+            StreamRange range = stream.write(batch.data(), batch.size() * sizeof(SphereInstance));
+            issue(queue, pass, impostorDraw(range.buffer, range.offset, sizeof(SphereInstance), (int)batch.size(), pass),
+                  batchDepthOf(batch.data(), (int)batch.size()));
+            stats.instances += (int)batch.size();
+            batch.clear();
+            return;
+        }
+
+        // counting sort by LOD so every level is one contiguous instance range
+        int lodCount = (int)mesh.lods.size();
+        std::vector<int> lodStart(lodCount + 1, 0);
+        batchLod.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); i++) {
+            batchLod[i] = mesh.selectLod(screenRadius(batch[i].pos, batch[i].radius));
+            lodStart[batchLod[i] + 1]++;
+        }
+        for (int l = 0; l < lodCount; l++)
+            lodStart[l + 1] += lodStart[l];
+        sorted.resize(batch.size());
+        std::vector<int> cursor(lodStart.begin(), lodStart.end() - 1);
+        for (size_t i = 0; i < batch.size(); i++)
+            sorted[cursor[batchLod[i]]++] = batch[i];
+
+        StreamRange range = stream.write(sorted.data(), sorted.size() * sizeof(SphereInstance));
+        for (int l = 0; l < lodCount; l++) {
+            int count = lodStart[l + 1] - lodStart[l];
+            if (count == 0)
+                continue;
+            // no base instance in GL 3.3, so each LOD re-points the instance attributes
+            issue(queue, pass, meshDraw(l, range.buffer, range.offset + lodStart[l] * sizeof(SphereInstance), sizeof(SphereInstance), count, pass),
+                  batchDepthOf(sorted.data() + lodStart[l], count));
+        }
+        stats.instances += (int)batch.size();
+
+        batch.clear();
+    }
+    // draws instances that already live in a GPU buffer (e.g. written by
+    // transform feedback). Each record must start with the SphereInstance
+    // layout; stride is the full record size. Without CPU-side radii there
+    // is no per-instance LOD, so the mesh path uses the smallest level,
+    // TRANSPARENCY_SORTED draws them unsorted, and the queue sorts them as
+    // far away (first among transparent draws, last among opaque ones).
+    // ------------------------------------------------------------------------
+    void drawInstanceBuffer(unsigned int buffer, int stride, int count, SphereDrawMode mode,
+                            RenderQueue* queue = NULL, RenderPass pass = RENDER_PASS_OPAQUE)
+    {
+        if (count == 0)
+            return;
+        if (mode == SPHERE_IMPOSTOR)
+            issue(queue, pass, impostorDraw(buffer, 0, stride, count, pass), 1.0f);
+        else
+            issue(queue, pass, meshDraw(0, buffer, 0, stride, count, pass), 1.0f);
+        stats.instances += count;
+    }
+
+private:
+    SphereMesh mesh;
+    unsigned int VAO, meshVBO, meshEBO;
+    unsigned int impostorID, impostorVAO, quadVBO;
+    unsigned int staticID, staticVAO, staticVBO;
+    unsigned int oitID, impostorOitID;
+    int oitViewProjectionLoc, impostorOitViewLoc, impostorOitProjectionLoc;
+    int staticViewProjectionLoc, staticTimeLoc;
+    int staticCount, staticLod;
+    int viewProjectionLoc;
+    int impostorViewLoc, impostorProjectionLoc;
+    StreamBuffer stream; // per-frame instance data
+    glm::mat4 view, projection, viewProjection;
+    std::vector<unsigned int> cameraSet; // programs given the camera directly this frame
+    float pixelsPerUnit;
+    float nearPlane, farPlane;
+    glm::vec3 staticCenter;
+    std::vector<SphereInstance> batch;
+    std::vector<SphereInstance> sorted;
+    std::vector<int> batchLod;
+    std::vector<float> batchDepth;
+    std::vector<int> depthOrder;
+
+    // the whole batch back to front in a single draw, so the GPU blends it
+    // in order; mesh spheres all take the LOD of the largest one on screen
+    void flushSorted(SphereDrawMode mode, RenderQueue* queue)
+    {
+        int n = (int)batch.size();
+        batchDepth.resize(n);
+        depthOrder.resize(n);
+        float largest = 0.0f;
+        for (int i = 0; i < n; i++) {
+            batchDepth[i] = (view * glm::vec4(batch[i].pos, 1.0f)).z; // more negative is farther
+            depthOrder[i] = i;
+            if (mode == SPHERE_MESH)
+                largest = std::max(largest, screenRadius(batch[i].pos, batch[i].radius));
+        }
+        std::sort(depthOrder.begin(), depthOrder.end(), [this](int a, int b) { return batchDepth[a] < batchDepth[b]; });
+        sorted.resize(n);
+        for (int i = 0; i < n; i++)
+            sorted[i] = batch[depthOrder[i]];
+
+        StreamRange range = stream.write(sorted.data(), n * sizeof(SphereInstance));
+        float depth = batchDepthOf(sorted.data(), n);
+        if (mode == SPHERE_IMPOSTOR)
+            issue(queue, RENDER_PASS_TRANSPARENT, impostorDraw(range.buffer, range.offset, sizeof(SphereInstance), n, RENDER_PASS_TRANSPARENT), depth);
+        else
+            issue(queue, RENDER_PASS_TRANSPARENT, meshDraw(mesh.selectLod(largest), range.buffer, range.offset, sizeof(SphereInstance), n, RENDER_PASS_TRANSPARENT), depth);
+        stats.instances += n;
+        batch.clear();
+    }
+
+    bool weighted(RenderPass pass) const
+    {
+        return pass == RENDER_PASS_TRANSPARENT && transparency == TRANSPARENCY_WEIGHTED;
+    }
+    DrawCall meshDraw(int level, unsigned int buffer, size_t offset, int stride, int count, RenderPass pass)
+    {
+        const SphereLod& lod = mesh.lods[level];
+        stats.vertices += lod.vertexCount * count;
+        return instancedDraw(weighted(pass) ? oitID : ID, VAO, GL_TRIANGLES, lod.firstIndex, lod.indexCount, true,
+                             buffer, offset, stride, count);
+    }
+    DrawCall impostorDraw(unsigned int buffer, size_t offset, int stride, int count, RenderPass pass)
+    {
+        stats.vertices += 4 * count;
+        return instancedDraw(weighted(pass) ? impostorOitID : impostorID, impostorVAO, GL_TRIANGLE_STRIP, 0, 4, false,
+                             buffer, offset, stride, count);
+    }
+    static DrawCall instancedDraw(unsigned int program, unsigned int vao, GLenum primitive, int first, int count, bool indexed,
+                                  unsigned int buffer, size_t offset, int stride, int instances)
+    {
+        DrawCall d = DrawCall();
+        d.program = program;
+        d.vao = vao;
+        d.primitive = primitive;
+        d.first = first;
+        d.count = count;
+        d.instances = instances;
+        d.indexed = indexed;
+        d.prepare = pointInstances;
+        d.buffer = buffer;
+        d.offset = offset;
+        d.stride = stride;
+        return d;
+    }
+
+    // queues the draw under the given depth, or issues it right away
+    // without a queue
+    void issue(RenderQueue* queue, RenderPass pass, const DrawCall& d, float depth)
+    {
+        stats.drawCalls++;
+        if (queue) {
+            queue->push(RenderQueue::makeKey(pass, d.program, d.vao, depth), d);
+            setCamera(queue, d.program);
+            return;
+        }
+        glBindVertexArray(d.vao);
+        if (d.prepare)
+            d.prepare(d);
+        glUseProgram(d.program);
+        if (std::find(cameraSet.begin(), cameraSet.end(), d.program) == cameraSet.end()) {
+            setCamera(NULL, d.program);
+            cameraSet.push_back(d.program);
+        }
+        if (d.indexed)
+            glDrawElementsInstanced(d.primitive, d.count, GL_UNSIGNED_INT, (void*)(d.first * sizeof(unsigned int)), d.instances);
+        else
+            glDrawArraysInstanced(d.primitive, d.first, d.count, d.instances);
+    }
+
+    // the program's camera uniforms, attached to the draw just queued or,
+    // without a queue, uploaded to the program in use
+    void setCamera(RenderQueue* queue, unsigned int program)
+    {
+        int viewProjectionAt = -1, viewAt = -1, projectionAt = -1;
+        if (program == ID)
+            viewProjectionAt = viewProjectionLoc;
+        else if (program == staticID)
+            viewProjectionAt = staticViewProjectionLoc;
+        else if (program == oitID)
+            viewProjectionAt = oitViewProjectionLoc;
+        else if (program == impostorID) {
+            viewAt = impostorViewLoc;
+            projectionAt = impostorProjectionLoc;
+        } else if (program == impostorOitID) {
+            viewAt = impostorOitViewLoc;
+            projectionAt = impostorOitProjectionLoc;
+        }
+        const int locations[3] = { viewProjectionAt, viewAt, projectionAt };
+        const glm::mat4* values[3] = { &viewProjection, &view, &projection };
+        for (int i = 0; i < 3; i++) {
+            if (locations[i] < 0)
+                continue;
+            if (queue) {
+                queue->uniform(locations[i], GL_FLOAT_MAT4, glm::value_ptr(*values[i]));
+            } else {
+                glUniformMatrix4fv(locations[i], 1, GL_FALSE, glm::value_ptr(*values[i]));
+                stats.uniformUploads++;
+            }
+        }
+    }
+
+    // the sort depth of a point: its view depth, 0 at the near plane and 1
+    // at the far one
+    float drawDepth(const glm::vec3& pos) const
+    {
+        float depth = -(view * glm::vec4(pos, 1.0f)).z;
+        return (depth - nearPlane) / (farPlane - nearPlane);
+    }
+    // the sort depth of a draw of instances: that of their centroid
+    float batchDepthOf(const SphereInstance* instances, int count) const
+    {
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < count; i++)
+            center += instances[i].pos;
+        return drawDepth(center / (float)count);
+    }
+
+    // DrawCall::prepare for every sphere draw; expects its VAO to be bound
+    static void pointInstances(const DrawCall& d)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, d.buffer);
+        pointInstanceAttributes(d.offset, d.stride);
+    }
+    static void pointInstanceAttributes(size_t offset, int stride)
+    {
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offset + 4 * sizeof(float)));
+    }
+
+    // expects the VAO and instance buffer to be bound
+    void enableInstanceAttributes()
+    {
+        pointInstanceAttributes(0, sizeof(SphereInstance));
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribDivisor(2, 1);
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "glad.h"
+
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const int STREAM_REGIONS = 3;          // frames the GPU may still be reading while we write the next
+const size_t STREAM_ALIGNMENT = 64;    // start of every sub-allocation
+
+// Counters for the current frame, reset by beginFrame()
+struct StreamStats {
+    size_t bytes;     // streamed this frame
+    int writes;       // sub-allocations this frame
+    int fenceWaits;   // times beginFrame() found the GPU still reading the region
+    int reallocations; // beginFrame() grew the buffer to fit the last frame
+    int overflows;    // writes that did not fit the region and got a buffer of their own
+};
+
+// Where write() put the bytes
+struct StreamRange {
+    unsigned int buffer;
+    size_t offset;
+};
+
+// One large GL buffer split into STREAM_REGIONS per-frame regions that are
+// used round-robin. write() sub-allocates from the current frame's region
+// and copies straight into mapped memory; beginFrame() fences the region
+// just finished and, before handing out the next one, waits on the fence
+// placed when that region was last used, so the GPU is never overwritten
+// while it reads and the driver never has to sync (or orphan) implicitly.
+// With ARB_buffer_storage (or GL 4.4) the buffer is mapped once,
+// persistently and coherently; otherwise every write() maps its own range
+// with glMapBufferRange, unsynchronized and invalidated, which the fences
+// make safe.
+//
+// Draws queued this frame refer to the buffer by name, so it is never
+// deleted while they may still run. The buffer only grows in beginFrame(),
+// to twice the last frame's peak, and the old one is retired until a fence
+// placed then has signaled. A write() that does not fit gets a buffer of
+// its own for the rest of the frame, retired the same way.
+class StreamBuffer
+{
+public:
+    unsigned int ID;
+    bool persistent; // mapped once for its lifetime
+    StreamStats stats;
+
+    StreamBuffer(size_t regionBytes, bool allowPersistent = true)
+    {
+        persistent = allowPersistent && (GLAD_GL_ARB_buffer_storage || GLAD_GL_VERSION_4_4);
+        ID = 0;
+        mapped = NULL;
+        peak = 0;
+        stats = StreamStats();
+        allocate(regionBytes);
+    }
+
+    ~StreamBuffer()
+    {
+        release();
+        glDeleteBuffers(1, &ID);
+        for (Retired& r : retired) {
+            if (r.fence)
+                glDeleteSync(r.fence);
+            glDeleteBuffers(1, &r.buffer);
+        }
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // fences the region the last frame wrote and moves on to the next one,
+    // waiting for the GPU if it is still reading that one. Nothing of this
+    // frame is queued yet, so this is where the buffer grows if the last
+    // frame did not fit.
+    // ------------------------------------------------------------------------
+    void beginFrame()
+    {
+        stats = StreamStats();
+        if (head > 0) {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % STREAM_REGIONS;
+        }
+        head = 0;
+        if (peak > regionBytes) {
+            retire(ID);
+            release();
+            allocate(peak * 2);
+            stats.reallocations++;
+        }
+        peak = 0;
+        collectRetired();
+        waitFor(region);
+    }
+    // copies bytes into this frame's region and says where they went; bytes
+    // that do not fit go to a buffer of their own, which lives until the
+    // GPU has finished the frame
+    // ------------------------------------------------------------------------
+    StreamRange write(const void* data, size_t bytes)
+    {
+        size_t aligned = (bytes + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+        peak += aligned;
+        if (head + bytes > regionBytes) {
+            StreamRange range = { 0, 0 };
+            glGenBuffers(1, &range.buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, range.buffer);
+            glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)bytes, data, GL_STREAM_DRAW);
+            retire(range.buffer);
+            stats.bytes += bytes;
+            stats.writes++;
+            stats.overflows++;
+            return range;
+        }
+        size_t offset = region * regionBytes + head;
+        if (persistent) {
+            memcpy(mapped + offset, data, bytes);
+        } else {
+            glBindBuffer(GL_ARRAY_BUFFER, ID);
+            void* p = glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if (p) {
+                memcpy(p, data, bytes);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+        }
+        head += aligned;
+        stats.bytes += bytes;
+        stats.writes++;
+        StreamRange range = { ID, offset };
+        return range;
+    }
+
+private:
+    size_t regionBytes;
+    size_t head;      // next free byte in the current region
+    int region;
+    GLsync fences[STREAM_REGIONS];
+    unsigned char* mapped; // whole buffer, persistent mode only
+    size_t peak;           // bytes written so far this frame, overflow included
+
+    // a buffer draws may still read; deleted once its fence has signaled
+    struct Retired {
+        unsigned int buffer;
+        GLsync fence; // 0 until the next beginFrame() places it
+    };
+    std::vector<Retired> retired;
+
+    void allocate(size_t bytes)
+    {
+        regionBytes = (bytes + STREAM_ALIGNMENT - 1) & ~(STREAM_ALIGNMENT - 1);
+        head = 0;
+        region = 0;
+        for (int r = 0; r < STREAM_REGIONS; r++)
+            fences[r] = 0;
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_ARRAY_BUFFER, ID);
+        GLsizeiptr total = (GLsizeiptr)(regionBytes * STREAM_REGIONS);
+        if (persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_ARRAY_BUFFER, total, NULL, flags);
+            mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+        } else {
+            glBufferData(GL_ARRAY_BUFFER, total, NULL, GL_STREAM_DRAW);
+        }
+    }
+    // unmaps the buffer and drops its fences; the caller deletes or
+    // retires the name
+    void release()
+    {
+        for (int r = 0; r < STREAM_REGIONS; r++)
+            if (fences[r])
+                glDeleteSync(fences[r]);
+        if (mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, ID);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            mapped = NULL;
+        }
+    }
+
+    void retire(unsigned int buffer)
+    {
+        retired.push_back({ buffer, 0 });
+    }
+    // fences what the last frame retired and deletes whatever the GPU is
+    // done with, without waiting; retiring is rare, so a fence each is fine
+    void collectRetired()
+    {
+        size_t kept = 0;
+        for (Retired& r : retired) {
+            if (!r.fence)
+                r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            else if (glClientWaitSync(r.fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+                glDeleteSync(r.fence);
+                glDeleteBuffers(1, &r.buffer);
+                continue;
+            }
+            retired[kept++] = r;
+        }
+        retired.resize(kept);
+    }
+
+    void waitFor(int r)
+    {
+        if (!fences[r])
+            return;
+        if (glClientWaitSync(fences[r], 0, 0) == GL_TIMEOUT_EXPIRED) {
+            stats.fenceWaits++;
+            // flush so the fence is sure to be reached; give up after a second
+            glClientWaitSync(fences[r], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        }
+        glDeleteSync(fences[r]);
+        fences[r] = 0;
+    }
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SWEPT_COLLISION_H
+#define SWEPT_COLLISION_H
+
+#include "glm/glm/glm.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+// Continuous collision for a sphere moving in a straight line over one tick.
+// Tests the whole path instead of only where the tick ends, so a fast sphere
+// or a long tick cannot step over something thinner than its motion.
+
+// Fraction (0..1) of the move from `from` to `to` at which a sphere of
+// `radius` first touches a static sphere, 0 if they already overlap, or -1
+// if they never overlap during the move. Merely grazing does not count,
+// matching a distance < sum-of-radii overlap test.
+inline float sweepSphereSphere(const glm::vec3& from, const glm::vec3& to, float radius,
+                               const glm::vec3& center, float otherRadius)
+{
+    glm::vec3 d = to - from;
+    glm::vec3 m = from - center;
+    float r = radius + otherRadius;
+    float c = glm::dot(m, m) - r * r;
+    if (c < 0.0f)
+        return 0.0f;
+    float b = glm::dot(m, d);
+    float a = glm::dot(d, d);
+    if (b >= 0.0f || a == 0.0f)
+        return -1.0f; // not moving, or moving away
+    float discriminant = b * b - a * c;
+    if (discriminant <= 0.0f)
+        return -1.0f; // passes by
+    float t = (-b - std::sqrt(discriminant)) / a;
+    return t < 1.0f ? t : -1.0f;
+}
+
+// Fraction of the move at which a center moving by `motion` from `from`
+// reaches the wall at +-boundary on one axis, or 1 if it stays inside
+inline float sweepWallTime(float from, float motion, float boundary)
+{
+    float end = from + motion;
+    float t = 1.0f;
+    if (end > boundary && motion > 0.0f)
+        t = (boundary - from) / motion;
+    else if (end < -boundary && motion < 0.0f)
+        t = (-boundary - from) / motion;
+    return glm::clamp(t, 0.0f, 1.0f);
+}
+
+// The path a sphere center takes moving by `motion` (x and y) inside the
+// square |x|, |y| <= boundary (the box walls already pulled in by the
+// radius): straight until it meets a wall, then sliding along it. Writes its
+// corners, start and end included, to path and returns how many there are
+// (2 to 4). The end equals clamping from + motion to the square.
+inline int sweepInsideBox(const glm::vec3& from, const glm::vec3& motion, float boundary, glm::vec3 path[4])
+{
+    float tx = sweepWallTime(from.x, motion.x, boundary);
+    float ty = sweepWallTime(from.y, motion.y, boundary);
+    float times[2] = { std::min(tx, ty), std::max(tx, ty) };
+    int corners = 0;
+    path[corners++] = from;
+    for (float t : times) {
+        if (t <= 0.0f || t >= 1.0f)
+            continue;
+        path[corners++] = glm::vec3(from.x + motion.x * std::min(t, tx), from.y + motion.y * std::min(t, ty), from.z);
+    }
+    path[corners++] = glm::vec3(glm::clamp(from.x + motion.x, -boundary, boundary),
+                                glm::clamp(from.y + motion.y, -boundary, boundary), from.z);
+    return corners;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free single-producer, single-consumer hand-off of the latest value.
+// The producer fills writeBuffer() and publish()es it; the consumer calls
+// fetch() and then reads readBuffer() for as long as it likes. Neither side
+// ever waits: the third buffer sits in the middle and the two sides swap
+// with it atomically. Values the consumer was too slow to fetch are dropped,
+// so it always sees the newest one.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : back(0), front(1), middle(2) {}
+
+    // producer side
+    // ------------------------------------------------------------------------
+    T& writeBuffer() { return buffers[back]; }
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // consumer side; returns false if nothing was published since the last fetch
+    // ------------------------------------------------------------------------
+    bool fetch()
+    {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T& readBuffer() const { return buffers[front]; }
+
+private:
+    enum { INDEX = 3, FRESH = 4 }; // middle holds a buffer index plus a "not yet fetched" bit
+
+    T buffers[3];
+    int back;  // only touched by the producer
+    int front; // only touched by the consumer
+    std::atomic<int> middle;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef WEIGHTED_OIT_H
+#define WEIGHTED_OIT_H
+
+#include "glad.h"
+
+#include "gl_program.h"
+
+#include <iostream>
+
+// Full-screen triangle from gl_VertexID, no vertex buffer needed
+static const char* oitCompositeVertexSource = "#version 330 core\n"
+"void main()\n"
+"{\n"
+"   vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+"   gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);\n"
+"}\0";
+
+// accum.rgb / weight is the weighted average color of every transparent
+// fragment; accum.a is how much of the background still shows through
+static const char* oitCompositeFragmentSource = "#version 330 core\n"
+"uniform sampler2D accumTexture;\n"
+"uniform sampler2D weightTexture;\n"
+"out vec4 FragColor;\n"
+"void main()\n"
+"{\n"
+"   ivec2 p = ivec2(gl_FragCoord.xy);\n"
+"   vec4 accum = texelFetch(accumTexture, p, 0);\n"
+"   float revealage = accum.a;\n"
+"   if (revealage >= 1.0) discard;\n"
+"   float weight = texelFetch(weightTexture, p, 0).r;\n"
+"   FragColor = vec4(accum.rgb / max(weight, 1e-5), revealage);\n"
+"}\0";
+
+// GLSL for transparent fragment shaders: call oitWrite(color, alpha, depth)
+// instead of writing a color. The weight favors near, opaque fragments
+// (McGuire & Bavoil 2013, eq. 10).
+#define OIT_FRAGMENT_OUTPUTS \
+"layout (location = 0) out vec4 oitAccum;\n" \
+"layout (location = 1) out vec4 oitWeight;\n" \
+"void oitWrite(vec3 color, float alpha, float depth)\n" \
+"{\n" \
+"   float w = clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - depth * 0.9, 3.0), 1e-2, 3e3);\n" \
+"   oitAccum = vec4(color * alpha * w, alpha);\n" \
+"   oitWeight = vec4(alpha * w);\n" \
+"}\n"
+
+// Weighted blended order-independent transparency. The opaque scene is drawn
+// into an offscreen target whose depth buffer the transparent pass tests
+// against without writing. Transparent fragments are summed, in any order,
+// into two more targets: an RGBA16F accumulation (color * alpha * weight in
+// rgb, the product of (1 - alpha) in a) and an R16F sum of alpha * weight.
+// resolve() blends their weighted average over the opaque scene, and
+// present() copies the result to the window. GL 3.3 has no per-target blend
+// functions, so both targets share glBlendFuncSeparate(ONE, ONE, ZERO,
+// ONE_MINUS_SRC_ALPHA): colors add up, the alpha channel multiplies.
+class WeightedBlendedOIT
+{
+public:
+    unsigned int ID; // composite program
+    bool complete;   // framebuffers usable; otherwise every call does nothing
+
+    WeightedBlendedOIT(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        ProgramBuild build = buildProgram(oitCompositeVertexSource, oitCompositeFragmentSource, "OIT_COMPOSITE");
+        glGenVertexArrays(1, &emptyVAO);
+
+        glGenTextures(1, &sceneColor);
+        glGenTextures(1, &accum);
+        glGenTextures(1, &weight);
+        createTarget(sceneColor, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        createTarget(accum, GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT);
+        createTarget(weight, GL_R16F, GL_RED, GL_HALF_FLOAT);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+        // opaque scene, and the transparent targets sharing its depth
+        glGenFramebuffers(1, &sceneFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sceneColor, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        complete = checkComplete("SCENE");
+
+        glGenFramebuffers(1, &transparentFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, transparentFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accum, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, weight, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+        GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, buffers);
+        complete = checkComplete("TRANSPARENT") && complete;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // compiled while the targets were created
+        ID = build.get();
+        glUseProgram(ID);
+        glUniform1i(glGetUniformLocation(ID, "accumTexture"), 0);
+        glUniform1i(glGetUniformLocation(ID, "weightTexture"), 1);
+    }
+
+    ~WeightedBlendedOIT()
+    {
+        glDeleteFramebuffers(1, &sceneFBO);
+        glDeleteFramebuffers(1, &transparentFBO);
+        glDeleteTextures(1, &sceneColor);
+        glDeleteTextures(1, &accum);
+        glDeleteTextures(1, &weight);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteProgram(ID);
+    }
+
+    // the opaque scene goes offscreen from here on; clear it as usual
+    // ------------------------------------------------------------------------
+    void beginScene()
+    {
+        if (complete)
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    }
+    // switches to the accumulation targets for everything transparent
+    // ------------------------------------------------------------------------
+    void beginTransparent()
+    {
+        if (!complete)
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, transparentFBO);
+        const float clearAccum[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // nothing summed, everything revealed
+        const float clearWeight[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, clearAccum);
+        glClearBufferfv(GL_COLOR, 1, clearWeight);
+        glDepthMask(GL_FALSE);
+        glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    // blends the transparent layer over the opaque scene
+    // ------------------------------------------------------------------------
+    void resolve()
+    {
+        if (!complete)
+            return;
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+        glUseProgram(ID);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, accum);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, weight);
+        glBindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_DEPTH_TEST);
+    }
+    // copies the finished scene to the window's framebuffer, which stays bound
+    // ------------------------------------------------------------------------
+    void present()
+    {
+        if (!complete)
+            return;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+private:
+    int width, height;
+    unsigned int sceneFBO, transparentFBO;
+    unsigned int sceneColor, accum, weight, depth;
+    unsigned int emptyVAO;
+
+    void createTarget(unsigned int texture, GLint internalFormat, GLenum format, GLenum type)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    bool checkComplete(const char* name)
+    {
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+            return true;
+        std::cout << "ERROR::OIT::FRAMEBUFFER_INCOMPLETE " << name << std::endl;
+        return false;
+    }
+};
+
+#endif
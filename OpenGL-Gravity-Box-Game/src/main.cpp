@@ -1,5 +1,7 @@
 #include "glad.h" // open gl func loader
+#ifndef GRAVITY_BOX_HEADLESS
 #include "glfw3.h" // window, i/o library
+#endif
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h" 
@@ -8,12 +10,34 @@
 #include "glm/glm/gtc/matrix_transform.hpp"
 #include "glm/glm/gtc/type_ptr.hpp"
 
+#include "sphere_renderer.h"
+#include "particle_pool.h"
+#include "gpu_particles.h"
+#include "spatial_grid.h"
+#include "fixed_timestep.h"
+#include "input_recording.h"
+#include "job_system.h"
+#include "triple_buffer.h"
+#include "hud_text.h"
+#include "profiler.h"
+#include "entity_store.h"
+#include "swept_collision.h"
+#include "poisson_disk.h"
+#include "shader_reflection.h"
+
 #include <iostream>
 #include <vector>
 #include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <future>
 
 // Shader sources (unchanged)
 const char* vertexShaderSource = "#version 330 core\n"
@@ -42,69 +66,322 @@ const unsigned int SCR_HEIGHT = 600;
 // Game structures
 struct Ball {
     glm::vec3 pos;
+    glm::vec3 prevPos; // pos one tick ago, for render interpolation
     glm::vec3 vel;
     glm::vec3 color;
     float radius;
 };
 
-struct Target {
-    glm::vec3 pos;
-    glm::vec3 color;
-    float radius;
-    bool collected;
-    float pulseTimer;
+// The wireframe cube's program with its uniform locations, resolved once
+// from the program's reflection instead of looked up every frame
+struct CubeShader {
+    unsigned int program;
+    int model, view, projection, color, alpha;
 };
 
-struct Particle {
+// Components of the level's static objects, stored per archetype in
+// arena-backed columns (entity_store.h)
+struct Body {
     glm::vec3 pos;
-    glm::vec3 vel;
+    float radius;
+};
+struct Tint {
     glm::vec3 color;
-    float life;
-    float size;
+};
+struct Pulse {
+    float phase; // offset added to levelTime
 };
 
-struct Hazard {
-    glm::vec3 pos;
+// Targets pulse out of step with each other, hazards all together
+typedef Archetype<Body, Tint, Pulse> TargetArchetype;
+typedef Archetype<Body, Tint> HazardArchetype;
+
+// The render thread's copy of the level's targets and hazards
+struct LevelObjects {
+    int generation; // which spawnLevel() the hazards came from; they are baked once per level
+    std::vector<Body> targetBodies;
+    std::vector<Tint> targetTints;
+    std::vector<Pulse> targetPulses;
+    std::vector<Body> hazardBodies;
+    std::vector<Tint> hazardTints;
+};
+
+// Where a level's scattered targets and hazards go. It depends only on the
+// run's seed, the level number and --stress, never on rand(), so the next
+// level's can be generated on a worker thread while this one is played,
+// and a restarted level comes back the same.
+struct LevelLayout {
+    int level;
+    int stressObjects;
+    uint32_t seed;
+    float radius;                   // of every scattered object
+    std::vector<glm::vec2> targets;
+    std::vector<float> targetPhases;
+    std::vector<glm::vec2> hazards; // besides the rows along the top and bottom
+};
+
+// Everything the simulation reads from the player for one tick. Movement
+// holds for every tick; the one-shot actions are consumed by the first
+// tick that runs after they were pressed.
+struct PlayerInput {
+    int moveX;          // -1, 0 or 1
+    bool flipGravity;   // space went down
+    bool reset;         // R is held
+    bool switchBackend; // G went down
+};
+
+// PlayerInput shared between the render thread, which polls the keys, and
+// the simulation thread. take() hands the one-shot actions to exactly one tick.
+struct SharedInput {
+    std::atomic<int> moveX;
+    std::atomic<bool> flipGravity;
+    std::atomic<bool> reset;
+    std::atomic<bool> switchBackend;
+
+    PlayerInput take()
+    {
+        PlayerInput in;
+        in.moveX = moveX.load();
+        in.flipGravity = flipGravity.exchange(false);
+        in.reset = reset.exchange(false);
+        in.switchBackend = switchBackend.exchange(false);
+        return in;
+    }
+};
+
+// Everything the render thread needs to draw one simulated tick. Targets and
+// hazards only change when a level spawns or a target is collected, so
+// snapshots share one copy of them until then instead of copying every tick.
+struct GameSnapshot {
+    double tickTime;  // wall time (wallTime()) the tick corresponds to
+    float dt;
+    glm::vec3 playerPos;
+    glm::vec3 playerPrevPos;
+    glm::vec3 playerColor;
+    float playerRadius;
+    std::shared_ptr<const LevelObjects> objects;
+    float levelTime;
+    std::vector<SphereInstance> particles; // CPU backend, ready to draw
+    std::vector<glm::vec2> particleVel;    // to rewind them for interpolation
+    int particleBackend;
+    int level;
+    int score;
+    int targetsRemaining;
+    double ticksPerSecond; // simulation stats over the last second
+    double tickMs;
+    int droppedFrames;     // frames whose tick backlog was dropped, since start
+    int layoutMisses;      // level layouts waited for or generated on the spot
+};
+
+// GpuParticleSystem calls made by the simulation. The GPU state lives in the
+// render thread's GL context, so while the simulation has its own thread
+// they are queued and replayed there in order.
+struct GpuParticleCommand {
+    enum Type { EMIT, UPDATE, CLEAR } type;
+    glm::vec3 pos;   // EMIT origin, UPDATE acceleration
     glm::vec3 color;
-    float radius;
-    float pulseTimer;
+    int count;
+    float deltaTime;
+    int seed;        // EMIT, drawn by the simulation so its rand() stream stays its own
+};
+
+// Where particles are simulated; toggled with G for A/B timing
+enum ParticleBackend {
+    PARTICLES_CPU, // ParticlePool, SIMD on the CPU
+    PARTICLES_GPU  // GpuParticleSystem, transform feedback
 };
 
 // Game state
 Ball player;
-std::vector<Target> targets;
-std::vector<Particle> particles;
-std::vector<Hazard> hazards;
+EntityArena levelArena;  // every level's targets and hazards; released in one go by spawnLevel()
+TargetArchetype targets; // collected targets are removed, so targets.count are left
+HazardArchetype hazards;
+ParticlePool particles(4096); // structure-of-arrays, swap-and-pop removal
+GpuParticleSystem* gpuParticles = NULL; // needs a GL context, created in main()
+ParticleBackend particleBackend = PARTICLES_CPU;
+SpatialGrid targetGrid;  // over entity ids, built by spawnLevel(); targets and hazards never move
+SpatialGrid hazardGrid;
+float levelTime = 0.0f;  // drives every pulse, so no per-object timers to advance
+int stressObjects = 0;   // extra targets/hazards per level, set with --stress N
 glm::vec3 gravity(0.0f, -0.6f, 0.0f); // Stronger gravity
 int score = 0;
 int level = 1;
+SphereDrawMode particleDrawMode = SPHERE_MESH; // toggled with I
+TransparencyMode particleTransparency = TRANSPARENCY_UNSORTED; // --transparency unsorted|sorted|oit, cycled with O
+FixedTimestep timestep(120.0f, 8); // --tick-rate N, --max-steps N
+SharedInput input;
+uint64_t simTick = 0;     // ticks simulated so far; the timestamp of recorded input
+uint32_t rngSeed = 0;     // the only source of randomness, so runs replay exactly
+InputRecorder recorder;   // --record file
+InputReplay* replay = NULL; // --replay file; overrides live input and the seed
+JobSystem* jobs = NULL;   // splits particle integration, --workers N
+Profiler* profiler = NULL; // --profile trace.json; every zone is a no-op without it
+
+// Simulation thread hand-off
+TripleBuffer<GameSnapshot> snapshots;
+std::shared_ptr<const LevelObjects> sharedObjects; // what snapshots currently point at
+int levelGeneration = 0;           // counts spawnLevel() calls
+std::shared_ptr<const LevelLayout> levelLayout; // the current level's
+std::shared_ptr<const LevelLayout> firstLayout; // level 1's, kept for resets
+std::future<std::shared_ptr<const LevelLayout>> nextLayout; // the next level's, generated on a worker
+int nextLayoutLevel = 0;           // which level nextLayout is generating
+std::vector<std::future<std::shared_ptr<const LevelLayout>>> staleLayouts; // unwanted, left to finish
+int layoutMisses = 0;              // levels whose layout was not ready ahead of time
+bool levelChanged = true;          // targets/hazards differ from the shared copy
+std::atomic<bool> simRunning(false);
+std::atomic<bool> simFinished(false); // a replay ran out
+bool queueGpuCommands = false;      // set while the simulation has its own thread
+std::mutex gpuCommandLock;
+std::vector<GpuParticleCommand> gpuCommands;
 
 // Function declarations
+#ifndef GRAVITY_BOX_HEADLESS
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
+void runSphereBenchmark(GLFWwindow* window, SphereRenderer& renderer, glm::mat4 view, glm::mat4 projection);
+void runParticleBackendBenchmark(GLFWwindow* window, SphereRenderer& renderer, glm::mat4 view, glm::mat4 projection);
+void runTransparencyBenchmark(GLFWwindow* window, SphereRenderer& renderer, WeightedBlendedOIT& oit, glm::mat4 view, glm::mat4 projection);
+#endif
+void applyInput(const PlayerInput& in);
+void stepGame(PlayerInput in);
+uint32_t stateHash();
+void simulationLoop();
+void publishSnapshot(double tickTime, double ticksPerSecond, double tickMs);
+double wallTime();
+void gpuParticleCommand(const GpuParticleCommand& command);
+void executeGpuParticleCommand(const GpuParticleCommand& command);
+void runGpuParticleCommands();
 void updateGame(float deltaTime);
 void spawnLevel(int level);
+std::shared_ptr<const LevelLayout> generateLevelLayout(int level, int stressObjects, uint32_t seed);
+std::shared_ptr<const LevelLayout> takeLevelLayout(int level);
 void createExplosion(glm::vec3 pos, glm::vec3 color, int count);
-void drawCube(unsigned int shaderProgram, unsigned int VAO, glm::mat4 view, glm::mat4 projection);
-void drawSphere(unsigned int shaderProgram, unsigned int sphereVAO, int sphereVertexCount,
-                glm::vec3 pos, float radius, glm::vec3 color, float alpha, glm::mat4 view, glm::mat4 projection);
+void clearParticles();
+void drawCube(RenderQueue& queue, const CubeShader& shader, unsigned int VAO, glm::mat4 view, glm::mat4 projection);
+void drawSphere(SphereRenderer& renderer, glm::vec3 pos, float radius, glm::vec3 color, float alpha);
+void runParticleBenchmark();
+void runHeadless(int ticks);
+void runJobBenchmark(int maxThreads);
+void runLevelBenchmark();
+PlayerInput scriptedInput(int tick);
 
 // Helper function to reset the game
 void resetGame() {
     player.pos = glm::vec3(0.0f, 0.0f, 0.0f);
+    player.prevPos = player.pos; // teleport, nothing to interpolate from
     player.vel = glm::vec3(0.0f, 0.0f, 0.0f);
     gravity = glm::vec3(0.0f, -0.6f, 0.0f);
-    targets.clear();
-    particles.clear();
-    hazards.clear();
-    spawnLevel(level);
+    spawnLevel(level); // releases the old level's objects and particles
     score = (level - 1) * 100; // Keep score from previous levels
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    srand(time(0));
+    rngSeed = (uint32_t)time(0);
+
+    bool vsync = false;
+    bool persistentStreaming = true;
+    bool programCache = true;
+    const char* recordPath = NULL;
+    const char* profilePath = NULL;
+    int workers = (int)std::thread::hardware_concurrency() - 1; // the main thread works too
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--vsync") == 0)
+            vsync = true;
+        if (strcmp(argv[i], "--no-persistent-map") == 0)
+            persistentStreaming = false; // map every upload with glMapBufferRange instead
+        if (strcmp(argv[i], "--no-program-cache") == 0)
+            programCache = false; // compile every program from source
+        if (i + 1 >= argc)
+            continue;
+        if (strcmp(argv[i], "--stress") == 0)
+            stressObjects = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--tick-rate") == 0)
+            timestep.setTickRate((float)atof(argv[i + 1]));
+        else if (strcmp(argv[i], "--max-steps") == 0)
+            timestep.maxSteps = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--workers") == 0)
+            workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--record") == 0)
+            recordPath = argv[i + 1];
+        else if (strcmp(argv[i], "--profile") == 0)
+            profilePath = argv[i + 1];
+        else if (strcmp(argv[i], "--transparency") == 0) {
+            if (strcmp(argv[i + 1], "sorted") == 0)
+                particleTransparency = TRANSPARENCY_SORTED;
+            else if (strcmp(argv[i + 1], "oit") == 0)
+                particleTransparency = TRANSPARENCY_WEIGHTED;
+            else
+                particleTransparency = TRANSPARENCY_UNSORTED;
+        }
+        else if (strcmp(argv[i], "--replay") == 0) {
+            replay = new InputReplay();
+            if (!replay->load(argv[i + 1]))
+                return -1;
+        }
+    }
+    bool headless = argc > 1 && strcmp(argv[1], "--headless") == 0;
+    if (headless)
+        rngSeed = 1; // scripted runs are comparable across builds
+    if (replay) {
+        // a recording only replays under the settings it was made with
+        if (stressObjects != (int)replay->stressObjects)
+            std::cout << "replay: using the recording's --stress " << replay->stressObjects << std::endl;
+        rngSeed = replay->seed;
+        timestep.setTickRate(replay->tickRate);
+        stressObjects = (int)replay->stressObjects;
+        particleBackend = (ParticleBackend)replay->particleBackend;
+    }
+    if (recordPath && !recorder.open(recordPath, rngSeed, timestep.tickRate, (uint32_t)stressObjects, (unsigned char)particleBackend))
+        return -1;
+    srand(rngSeed);
+
+    // Initialize player ball
+    player.color = glm::vec3(0.0f, 1.0f, 1.0f);
+    player.radius = 0.05f;
+
+    // CPU-only modes, need no window or GL context
+    if (argc > 1 && strcmp(argv[1], "--bench-particles") == 0) {
+        runParticleBenchmark();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-jobs") == 0) {
+        runJobBenchmark(argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency());
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-levels") == 0) {
+        runLevelBenchmark();
+        return 0;
+    }
+    jobs = new JobSystem(workers);
+    if (headless) {
+        // N is optional: the whole recording when replaying, else 100000 ticks
+        int ticks = argc > 2 && argv[2][0] != '-' ? atoi(argv[2]) : (replay ? 0 : 100000);
+        if (profilePath) {
+            profiler = new Profiler(false); // no GL context, CPU zones only
+            profiler->nameThread("simulation");
+        }
+        runHeadless(ticks);
+        recorder.close(simTick);
+        if (profiler) {
+            profiler->writeChromeTrace(profilePath);
+            profiler->printSummary();
+            delete profiler;
+        }
+        delete replay;
+        delete jobs;
+        return 0;
+    }
 
+#ifdef GRAVITY_BOX_HEADLESS
+    std::cout << "built without a window: run with --headless [N], --bench-particles, --bench-jobs or --bench-levels" << std::endl;
+    (void)vsync;
+    (void)persistentStreaming;
+    (void)programCache;
+    delete replay;
+    delete jobs;
+    return -1;
+#else
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -118,6 +395,7 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSwapInterval(vsync ? 1 : 0); // the simulation rate no longer depends on it
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
@@ -128,22 +406,17 @@ int main()
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // alpha blend
 
-    // Compile shaders (unchanged)
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    // Linked programs are kept as driver binaries under shader_cache/, so
+    // only the first run (or the first after a driver update) compiles them
+    auto rendererStart = std::chrono::steady_clock::now();
+    ProgramCache* shaderCache = programCache ? new ProgramCache("shader_cache") : NULL;
+    ProgramCache::current = shaderCache;
+    // Programs are submitted without waiting and checked once the buffers
+    // and textures around them exist; with KHR_parallel_shader_compile the
+    // driver builds them on its own threads in the meantime
+    bool parallelCompile = enableParallelShaderCompile((GLADloadproc)glfwGetProcAddress);
 
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    ProgramBuild cubeBuild = buildProgram(vertexShaderSource, fragmentShaderSource, "CUBE");
 
     // Create cube vertices (unchanged)
     float cubeVertices[] = {
@@ -170,171 +443,528 @@ int main()
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
-    // Create sphere vertices (unchanged)
-    std::vector<float> sphereVertices;
-    const int segments = 20;
-    const int rings = 20;
-    for (int i = 0; i <= rings; i++) {
-        float theta1 = i * 3.14159f / rings;
-        float theta2 = (i + 1) * 3.14159f / rings;
-        for (int j = 0; j <= segments; j++) {
-            float phi1 = j * 2.0f * 3.14159f / segments;
-            float phi2 = (j + 1) * 2.0f * 3.14159f / segments;
-            sphereVertices.push_back(sin(theta1) * cos(phi1));
-            sphereVertices.push_back(cos(theta1));
-            sphereVertices.push_back(sin(theta1) * sin(phi1));
-            sphereVertices.push_back(sin(theta2) * cos(phi1));
-            sphereVertices.push_back(cos(theta2));
-            sphereVertices.push_back(sin(theta2) * sin(phi1));
-            sphereVertices.push_back(sin(theta2) * cos(phi2));
-            sphereVertices.push_back(cos(theta2));
-            sphereVertices.push_back(sin(theta2) * sin(phi2));
-            sphereVertices.push_back(sin(theta1) * cos(phi1));
-            sphereVertices.push_back(cos(theta1));
-            sphereVertices.push_back(sin(theta1) * sin(phi1));
-            sphereVertices.push_back(sin(theta2) * cos(phi2));
-            sphereVertices.push_back(cos(theta2));
-            sphereVertices.push_back(sin(theta2) * sin(phi2));
-            sphereVertices.push_back(sin(theta1) * cos(phi2));
-            sphereVertices.push_back(cos(theta1));
-            sphereVertices.push_back(sin(theta1) * sin(phi2));
-        }
+    // All spheres are drawn instanced from an indexed, LOD-selected mesh,
+    // with the instance data streamed through a fenced ring of buffer regions
+    SphereRenderer* sphereRenderer = new SphereRenderer(persistentStreaming);
+    std::cout << "instance streaming: " << (sphereRenderer->persistentStreaming() ? "persistent mapping" : "glMapBufferRange per upload") << std::endl;
+    gpuParticles = new GpuParticleSystem(65536);
+    HudText* hud = new HudText("resources/hud_font.png", SCR_WIDTH, SCR_HEIGHT, 2.0f);
+    // offscreen targets for weighted blended transparency (TRANSPARENCY_WEIGHTED)
+    WeightedBlendedOIT* oit = new WeightedBlendedOIT(SCR_WIDTH, SCR_HEIGHT);
+
+    unsigned int shaderProgram = cubeBuild.get();
+    ShaderReflection cubeReflection(shaderProgram);
+    CubeShader cubeShader = { shaderProgram, cubeReflection.uniformLocation("model"), cubeReflection.uniformLocation("view"),
+                              cubeReflection.uniformLocation("projection"), cubeReflection.uniformLocation("color"),
+                              cubeReflection.uniformLocation("alpha") };
+
+    // cold (compiling) vs warm (loading binaries) startup
+    double rendererMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rendererStart).count();
+    if (shaderCache && shaderCache->enabled) {
+        const ProgramCacheStats& stats = shaderCache->stats;
+        std::cout << "renderer startup: " << rendererMs << " ms (" << (stats.misses + stats.rejected ? "cold" : "warm")
+                  << "; programs: " << stats.hits << " cached, " << stats.misses + stats.rejected << " compiled, "
+                  << stats.rejected << " stale, " << stats.pruned << " pruned)" << std::endl;
+    }
+    else
+        std::cout << "renderer startup: " << rendererMs << " ms (program cache " << (shaderCache ? "unsupported" : "off") << ")" << std::endl;
+    std::cout << "shader compilation: " << (parallelCompile ? "parallel (KHR_parallel_shader_compile)" : "driver default") << std::endl;
+    ProgramCache::current = NULL;
+    delete shaderCache;
+
+    // Camera is fixed, looking at the center from the front
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f),
+                                           (float)SCR_WIDTH / (float)SCR_HEIGHT,
+                                           0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
+                               glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+
+    if (argc > 1 && strcmp(argv[1], "--bench-spheres") == 0) {
+        runSphereBenchmark(window, *sphereRenderer, view, projection);
+        delete oit;
+        delete hud;
+        delete sphereRenderer;
+        delete gpuParticles;
+        glfwTerminate();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-particle-backends") == 0) {
+        runParticleBackendBenchmark(window, *sphereRenderer, view, projection);
+        delete oit;
+        delete hud;
+        delete sphereRenderer;
+        delete gpuParticles;
+        glfwTerminate();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench-transparency") == 0) {
+        runTransparencyBenchmark(window, *sphereRenderer, *oit, view, projection);
+        delete oit;
+        delete hud;
+        delete sphereRenderer;
+        delete gpuParticles;
+        glfwTerminate();
+        return 0;
     }
 
-    unsigned int sphereVBO, sphereVAO;
-    glGenVertexArrays(1, &sphereVAO);
-    glGenBuffers(1, &sphereVBO);
-    glBindVertexArray(sphereVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
-    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Initialize player ball
-    player.color = glm::vec3(0.0f, 1.0f, 1.0f);
-    player.radius = 0.05f;
-
+    srand(rngSeed);
     spawnLevel(level);
     resetGame();
 
-    float lastTime = glfwGetTime();
+    // The simulation runs on its own thread in fixed ticks and publishes a
+    // snapshot after each batch of them. This thread only polls input and
+    // draws the newest snapshot, so a slow tick never delays a swap.
+    if (profilePath) {
+        profiler = new Profiler(true);
+        profiler->nameThread("render");
+    }
+    queueGpuCommands = true;
+    publishSnapshot(wallTime(), 0.0, 0.0);
+    snapshots.fetch();
+    simRunning = true;
+    std::thread simulation(simulationLoop);
+
+    int frames = 0, windowFrames = 0;
+    double frameStart = wallTime(), windowStart = frameStart, firstFrame = frameStart;
+    double frameMs = 0.0, latencyMs = 0.0, windowLatency = 0.0;
+    int windowFenceWaits = 0;
+    RenderQueue renderQueue;
+    std::vector<StaticSphere> staticSpheres;
+    int bakedGeneration = -1;
+    int shownLevel = -1, shownScore = -1, shownTargets = -1, shownBackend = -1, shownTransparency = -1, shownDropped = -1;
+    int shownMisses = -1;
+    double shownTicksPerSecond = -1.0, shownTickMs = -1.0;
 
     // Game loop
     while (!glfwWindowShouldClose(window))
     {
-        float currentTime = glfwGetTime();
-        float deltaTime = currentTime - lastTime;
-        lastTime = currentTime;
-        
-        // Cap delta time to prevent physics explosions
-        if (deltaTime > 0.1f) deltaTime = 0.1f;
-
-        processInput(window);
-        updateGame(deltaTime);
+        ProfileZone frameZone(profiler, "frame");
+        if (profiler)
+            profiler->beginFrame();
+        {
+            ProfileZone zone(profiler, "input");
+            processInput(window);
+        }
+        if (simFinished)
+            glfwSetWindowShouldClose(window, true);
+
+        snapshots.fetch();
+        const GameSnapshot& snap = snapshots.readBuffer();
+        {
+            ProfileZone zone(profiler, "particle commands");
+            GpuProfileZone gpuZone(profiler, "particle update");
+            runGpuParticleCommands();
+        }
+        ProfileZone drawZone(profiler, "build");
+
+        // Draw between the snapshot's tick and the one before it
+        double now = wallTime();
+        float tickAlpha = glm::clamp((float)((now - snap.tickTime) / snap.dt), 0.0f, 1.0f);
+        float rewind = (1.0f - tickAlpha) * snap.dt; // how far the drawn state lags the simulated one
+        glm::vec3 playerDrawPos = glm::mix(snap.playerPrevPos, snap.playerPos, tickAlpha);
+        float drawTime = snap.levelTime - rewind;
+        windowLatency += now - snap.tickTime;
+
+        // weighted blending draws the scene offscreen and composites it there
+        TransparencyMode transparency = particleTransparency;
+        if (transparency == TRANSPARENCY_WEIGHTED && !oit->complete)
+            transparency = TRANSPARENCY_UNSORTED;
+        sphereRenderer->transparency = transparency;
+        if (transparency == TRANSPARENCY_WEIGHTED)
+            oit->beginScene();
 
         glClearColor(0.1f, 0.1f, 0.15f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
-
-        // Setup 3D camera - STATIC
-        glm::mat4 projection = glm::perspective(glm::radians(60.0f),
-                                               (float)SCR_WIDTH / (float)SCR_HEIGHT,
-                                               0.1f, 100.0f);
-        // Camera is now fixed, looking at the center from the front
-        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f),
-                                   glm::vec3(0.0f, 0.0f, 0.0f),
-                                   glm::vec3(0.0f, 1.0f, 0.0f));
+        // Everything is queued first, then sorted and submitted in one go
+        renderQueue.clear();
 
         // Draw static cube wireframe
-        drawCube(shaderProgram, cubeVAO, view, projection);
+        drawCube(renderQueue, cubeShader, cubeVAO, view, projection);
+
+        sphereRenderer->beginFrame(view, projection, SCR_HEIGHT);
 
         // Draw player ball
-        drawSphere(shaderProgram, sphereVAO, sphereVertices.size() / 3,
-                   player.pos, player.radius, player.color, 1.0f, view, projection);
-
-        // Draw targets with pulse effect
-        for (auto& target : targets) {
-            if (!target.collected) {
-                float pulseSize = target.radius * (1.0f + sin(target.pulseTimer * 5.0f) * 0.2f);
-                drawSphere(shaderProgram, sphereVAO, sphereVertices.size() / 3,
-                           target.pos, pulseSize, target.color, 1.0f, view, projection);
-            }
+        drawSphere(*sphereRenderer, playerDrawPos, snap.playerRadius, snap.playerColor, 1.0f);
+
+        // Draw targets with pulse effect; only uncollected ones are left
+        const LevelObjects& objects = *snap.objects;
+        for (size_t i = 0; i < objects.targetBodies.size(); i++) {
+            const Body& body = objects.targetBodies[i];
+            float pulseSize = body.radius * (1.0f + sin((objects.targetPulses[i].phase + drawTime) * 5.0f) * 0.2f);
+            drawSphere(*sphereRenderer, body.pos, pulseSize, objects.targetTints[i].color, 1.0f);
         }
 
-        // Draw hazards
-        for (auto& hazard : hazards) {
-            float pulseSize = hazard.radius * (1.0f + cos(hazard.pulseTimer * 3.0f) * 0.15f);
-             drawSphere(shaderProgram, sphereVAO, sphereVertices.size() / 3,
-                       hazard.pos, pulseSize, hazard.color, 1.0f, view, projection);
+        sphereRenderer->flush(SPHERE_MESH, &renderQueue); // one batch for player and targets
+
+        // Draw hazards: they never move, so they are baked when a level
+        // spawns and pulse in the vertex shader, one draw however many there are
+        if (objects.generation != bakedGeneration) {
+            staticSpheres.clear();
+            for (size_t i = 0; i < objects.hazardBodies.size(); i++) {
+                const Body& body = objects.hazardBodies[i];
+                staticSpheres.push_back({ body.pos, body.radius, objects.hazardTints[i].color, 1.0f, 0.0f, 3.0f, 0.15f, 0.0f });
+            }
+            sphereRenderer->bakeStatic(staticSpheres);
+            bakedGeneration = objects.generation;
         }
+        sphereRenderer->drawStatic(drawTime, &renderQueue);
 
         // Draw particles
-        for (auto& p : particles) {
-            float alpha = p.life / 2.0f; // Fade out
-            drawSphere(shaderProgram, sphereVAO, sphereVertices.size() / 3,
-                       p.pos, p.size, p.color, alpha, view, projection);
+        if (snap.particleBackend == PARTICLES_GPU) {
+            // already laid out as instance data, nothing goes through the CPU
+            sphereRenderer->drawInstanceBuffer(gpuParticles->stateBuffer(), sizeof(GpuParticle),
+                                               gpuParticles->slotCount(), particleDrawMode,
+                                               &renderQueue, RENDER_PASS_TRANSPARENT);
+        } else {
+            for (size_t i = 0; i < snap.particles.size(); i++) {
+                const SphereInstance& p = snap.particles[i]; // alpha already fades with life
+                glm::vec3 pos = p.pos - glm::vec3(snap.particleVel[i] * rewind, 0.0f);
+                drawSphere(*sphereRenderer, pos, p.radius, p.color, p.alpha);
+            }
+            sphereRenderer->flush(particleDrawMode, &renderQueue, RENDER_PASS_TRANSPARENT);
+        }
+        drawZone.end();
+        {
+            ProfileZone zone(profiler, "submit");
+            GpuProfileZone gpuZone(profiler, "scene");
+            renderQueue.submit(RENDER_PASS_OPAQUE, RENDER_PASS_OPAQUE);
+            if (transparency == TRANSPARENCY_WEIGHTED)
+                oit->beginTransparent();
+            renderQueue.submit(RENDER_PASS_TRANSPARENT, RENDER_PASS_TRANSPARENT);
+            if (transparency == TRANSPARENCY_WEIGHTED) {
+                oit->resolve();
+                oit->present();
+            }
+            renderQueue.submit(RENDER_PASS_OVERLAY, RENDER_PASS_OVERLAY);
         }
 
-        // Update window title
-        int targetsLeft = 0;
-        for(auto& t : targets) if(!t.collected) targetsLeft++;
-        
-        char title[100];
-        sprintf(title, "GRAVITY BOX | Level: %d | Score: %d | Targets Left: %d",
-                level, score, targetsLeft);
-        glfwSetWindowTitle(window, title);
+        // HUD; lines are only reformatted when a value on them changes, and
+        // the glyph quads only rebuilt when a line's text did
+        char line[128];
+        if (snap.level != shownLevel || snap.score != shownScore || snap.targetsRemaining != shownTargets) {
+            snprintf(line, sizeof(line), "LEVEL %d   SCORE %d   TARGETS LEFT %d", snap.level, snap.score, snap.targetsRemaining);
+            hud->setLine(0, line, glm::vec4(1.0f, 1.0f, 1.0f, 0.9f));
+            shownLevel = snap.level;
+            shownScore = snap.score;
+            shownTargets = snap.targetsRemaining;
+        }
+        // simulation cost is measured on its own thread, once a second
+        if (snap.ticksPerSecond != shownTicksPerSecond || snap.tickMs != shownTickMs || snap.particleBackend != shownBackend ||
+            snap.droppedFrames != shownDropped) {
+            snprintf(line, sizeof(line), "SIM %.0f TICKS/S  %.3f MS/TICK  %d DROPPED  PARTICLES %s", snap.ticksPerSecond, snap.tickMs,
+                     snap.droppedFrames, snap.particleBackend == PARTICLES_GPU ? "GPU" : "CPU");
+            hud->setLine(2, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            shownTicksPerSecond = snap.ticksPerSecond;
+            shownTickMs = snap.tickMs;
+            shownBackend = snap.particleBackend;
+            shownDropped = snap.droppedFrames;
+        }
+        if (snap.layoutMisses != shownMisses) {
+            snprintf(line, sizeof(line), "LATE LEVEL LAYOUTS %d", snap.layoutMisses);
+            hud->setLine(6, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            shownMisses = snap.layoutMisses;
+        }
+        if (transparency != shownTransparency) {
+            const char* names[] = { "UNSORTED", "SORTED", "WEIGHTED OIT" };
+            snprintf(line, sizeof(line), "TRANSPARENCY %s", names[transparency]);
+            hud->setLine(5, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            shownTransparency = transparency;
+        }
+        {
+            ProfileZone zone(profiler, "hud");
+            GpuProfileZone gpuZone(profiler, "hud");
+            hud->draw();
+        }
+
+        {
+            ProfileZone zone(profiler, "swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            ProfileZone zone(profiler, "events");
+            glfwPollEvents();
+        }
+
+        frames++;
+        windowFrames++;
+        windowFenceWaits += sphereRenderer->streamStats().fenceWaits;
+        frameStart = wallTime();
+        if (frameStart - windowStart >= 1.0) {
+            frameMs = (frameStart - windowStart) * 1000.0 / windowFrames;
+            latencyMs = windowLatency * 1000.0 / windowFrames;
+            snprintf(line, sizeof(line), "FRAME %.2f MS  LAG %.1f MS  DRAWS %d  VERTS %d", frameMs, latencyMs,
+                     sphereRenderer->stats.drawCalls, sphereRenderer->stats.vertices);
+            hud->setLine(1, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            const StreamStats& stream = sphereRenderer->streamStats();
+            snprintf(line, sizeof(line), "STREAM %.1f KB/FRAME  %d WRITES  %d FENCE WAITS/S", stream.bytes / 1024.0,
+                     stream.writes, windowFenceWaits);
+            hud->setLine(3, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            windowFenceWaits = 0;
+            const RenderQueueStats& queued = renderQueue.stats;
+            snprintf(line, sizeof(line), "QUEUE %d DRAWS  %d PROGRAMS  %d VAOS  %d UNIFORMS  %d SKIPPED", queued.draws,
+                     queued.programBinds, queued.vaoBinds, queued.uniformUploads, queued.uniformsSkipped);
+            hud->setLine(4, line, glm::vec4(0.6f, 0.8f, 1.0f, 0.8f));
+            windowStart = frameStart;
+            windowFrames = 0;
+            windowLatency = 0.0;
+        }
+    }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    simRunning = false;
+    simulation.join();
+    queueGpuCommands = false;
+    std::cout << "frames: " << frames << ", avg frame ms: " << (frameStart - firstFrame) * 1000.0 / std::max(frames, 1)
+              << " | ticks: " << simTick << " | HUD rebuilds: " << hud->rebuilds << std::endl;
+    if (profiler) {
+        profiler->writeChromeTrace(profilePath);
+        profiler->printSummary();
+        delete profiler; // owns GL queries, goes before the context
+        profiler = NULL;
     }
 
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteBuffers(1, &cubeVBO);
-    glDeleteVertexArrays(1, &sphereVAO);
-    glDeleteBuffers(1, &sphereVBO);
+    delete oit;
+    delete hud;
+    delete sphereRenderer;
+    delete gpuParticles;
     glDeleteProgram(shaderProgram);
+    recorder.close(simTick);
+    delete replay;
+    delete jobs;
 
     glfwTerminate();
     return 0;
+#endif
 }
 
+#ifndef GRAVITY_BOX_HEADLESS
 void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    float moveSpeed = 1.0f;
-    
     // Horizontal Movement
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-        player.vel.x = -moveSpeed;
+        input.moveX = -1;
     else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-        player.vel.x = moveSpeed;
+        input.moveX = 1;
     else
-        player.vel.x = 0; // Stop immediately
+        input.moveX = 0; // Stop immediately
 
-    // Gravity flip
+    // Gravity flip, applied by the next tick
     static bool spacePressed = false;
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && !spacePressed) {
-        gravity.y *= -1.0f;
-        // Add a small opposite velocity to "jump" off the surface
-        player.vel.y = gravity.y * 0.1f; 
-        createExplosion(player.pos, glm::vec3(1.0f, 1.0f, 0.0f), 20);
+        input.flipGravity = true;
         spacePressed = true;
     }
     if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_RELEASE)
         spacePressed = false;
 
+    // Toggle particle rendering between tessellated mesh and ray-cast impostors
+    static bool impostorPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS && !impostorPressed) {
+        particleDrawMode = (particleDrawMode == SPHERE_MESH) ? SPHERE_IMPOSTOR : SPHERE_MESH;
+        impostorPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_RELEASE)
+        impostorPressed = false;
+
+    // Cycle how transparent particles are composited: unsorted, sorted, OIT
+    static bool transparencyPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !transparencyPressed) {
+        particleTransparency = (TransparencyMode)((particleTransparency + 1) % 3);
+        transparencyPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE)
+        transparencyPressed = false;
+
+    // Switch the particle simulation between CPU and GPU; a tick input, since
+    // the two backends draw different amounts of randomness
+    static bool backendPressed = false;
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS && !backendPressed) {
+        input.switchBackend = true;
+        backendPressed = true;
+    }
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_RELEASE)
+        backendPressed = false;
+
     // Reset
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
+        input.reset = true;
+}
+#endif
+
+// Applies one tick's input to the game state; the only way input reaches
+// the simulation, so it runs the same with or without a window
+void applyInput(const PlayerInput& in)
+{
+    float moveSpeed = 1.0f;
+    player.vel.x = in.moveX * moveSpeed;
+
+    if (in.flipGravity) {
+        gravity.y *= -1.0f;
+        // Add a small opposite velocity to "jump" off the surface
+        player.vel.y = gravity.y * 0.1f;
+        createExplosion(player.pos, glm::vec3(1.0f, 1.0f, 0.0f), 20);
+    }
+
+    if (in.switchBackend) {
+        clearParticles();
+        particleBackend = (particleBackend == PARTICLES_CPU) ? PARTICLES_GPU : PARTICLES_CPU;
+    }
+
+    if (in.reset) {
         level = 1;
         resetGame();
     }
 }
 
+// Advances the simulation by one fixed tick. The input is recorded, or
+// replaced by the recorded one when replaying.
+void stepGame(PlayerInput in)
+{
+    if (replay) {
+        unsigned char bits = replay->inputAt(simTick);
+        in.moveX = (bits & 3) - 1;
+        in.flipGravity = (bits & 4) != 0;
+        in.reset = (bits & 8) != 0;
+        in.switchBackend = (bits & 16) != 0;
+    }
+    recorder.record(simTick, packInput(in.moveX, in.flipGravity, in.reset, in.switchBackend));
+
+    ProfileZone zone(profiler, "tick");
+    player.prevPos = player.pos;
+    applyInput(in);
+    updateGame(timestep.dt);
+    simTick++;
+}
+
+// Simulation thread: runs fixed ticks in real time and publishes a snapshot
+// after each batch, until the render thread clears simRunning
+void simulationLoop()
+{
+    double last = wallTime();
+    double windowStart = last, windowBusy = 0.0;
+    int windowTicks = 0;
+    double ticksPerSecond = 0.0, tickMs = 0.0;
+    if (profiler)
+        profiler->nameThread("simulation");
+
+    while (simRunning) {
+        double now = wallTime();
+        int steps = timestep.advance(now - last);
+        last = now;
+        for (int step = 0; step < steps && !simFinished; step++) {
+            if (replay && replay->finished(simTick)) {
+                std::cout << "replay finished after " << simTick << " ticks, state hash " << std::hex << stateHash() << std::dec << std::endl;
+                simFinished = true;
+                break;
+            }
+            double start = wallTime();
+            stepGame(input.take());
+            windowBusy += wallTime() - start;
+            windowTicks++;
+        }
+
+        if (now - windowStart >= 1.0) {
+            ticksPerSecond = windowTicks / (now - windowStart);
+            tickMs = windowTicks > 0 ? windowBusy * 1000.0 / windowTicks : 0.0;
+            windowStart = now;
+            windowBusy = 0.0;
+            windowTicks = 0;
+        }
+        if (steps > 0) {
+            ProfileZone zone(profiler, "publish");
+            publishSnapshot(now - timestep.alpha() * timestep.dt, ticksPerSecond, tickMs);
+        }
+
+        // sleep until the next tick is due
+        std::this_thread::sleep_for(std::chrono::duration<double>((1.0f - timestep.alpha()) * timestep.dt));
+    }
+}
+
+// Copies the state the renderer draws into the triple buffer's free slot
+void publishSnapshot(double tickTime, double ticksPerSecond, double tickMs)
+{
+    GameSnapshot& s = snapshots.writeBuffer();
+    s.tickTime = tickTime;
+    s.dt = timestep.dt;
+    s.playerPos = player.pos;
+    s.playerPrevPos = player.prevPos;
+    s.playerColor = player.color;
+    s.playerRadius = player.radius;
+    if (levelChanged) {
+        // the columns live in the level arena, which the simulation may
+        // release at any tick, so the render thread gets its own copy
+        std::shared_ptr<LevelObjects> objects = std::make_shared<LevelObjects>();
+        objects->generation = levelGeneration;
+        objects->targetBodies.assign(targets.column<Body>(), targets.column<Body>() + targets.count);
+        objects->targetTints.assign(targets.column<Tint>(), targets.column<Tint>() + targets.count);
+        objects->targetPulses.assign(targets.column<Pulse>(), targets.column<Pulse>() + targets.count);
+        objects->hazardBodies.assign(hazards.column<Body>(), hazards.column<Body>() + hazards.count);
+        objects->hazardTints.assign(hazards.column<Tint>(), hazards.column<Tint>() + hazards.count);
+        sharedObjects = objects;
+        levelChanged = false;
+    }
+    s.objects = sharedObjects;
+    s.levelTime = levelTime;
+
+    // vectors keep their capacity, so this settles into plain copies
+    s.particles.resize(particleBackend == PARTICLES_CPU ? particles.count : 0);
+    s.particleVel.resize(s.particles.size());
+    for (size_t i = 0; i < s.particles.size(); i++) {
+        s.particles[i].pos = particles.position((int)i);
+        s.particles[i].radius = particles.size[i];
+        s.particles[i].color = particles.color((int)i);
+        s.particles[i].alpha = particles.life[i] / 2.0f; // Fade out
+        s.particleVel[i] = glm::vec2(particles.velX[i], particles.velY[i]);
+    }
+
+    s.particleBackend = particleBackend;
+    s.level = level;
+    s.score = score;
+    s.targetsRemaining = targets.count;
+    s.ticksPerSecond = ticksPerSecond;
+    s.tickMs = tickMs;
+    s.droppedFrames = timestep.droppedFrames;
+    s.layoutMisses = layoutMisses;
+    snapshots.publish();
+}
+
+// Seconds on a monotonic clock that both threads can read
+double wallTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// FNV-1a over the simulated state, to check that two runs of the same
+// recording ended up bit-identical
+uint32_t stateHash()
+{
+    uint32_t h = 2166136261u;
+    auto mix = [&h](const void* data, size_t bytes) {
+        for (size_t i = 0; i < bytes; i++)
+            h = (h ^ ((const unsigned char*)data)[i]) * 16777619u;
+    };
+    mix(&player.pos, sizeof(player.pos));
+    mix(&player.vel, sizeof(player.vel));
+    mix(&gravity, sizeof(gravity));
+    mix(&score, sizeof(score));
+    mix(&level, sizeof(level));
+    mix(&targets.count, sizeof(targets.count));
+    mix(&particles.count, sizeof(particles.count));
+    mix(particles.posX, particles.count * sizeof(float));
+    mix(particles.posY, particles.count * sizeof(float));
+    return h;
+}
+
 void updateGame(float deltaTime)
 {
+    glm::vec3 start = player.pos;
+
     // Apply gravity
     player.vel += gravity * deltaTime;
 
@@ -346,6 +976,12 @@ void updateGame(float deltaTime)
 
     // Cube boundary collision (now 2D)
     float boundary = 0.8f - player.radius;
+
+    // The path the ball actually took this tick, straight until it met a
+    // wall and sliding along it after; hazards and targets are tested
+    // against all of it, so nothing is skipped however far a tick moves
+    glm::vec3 path[4];
+    int corners = sweepInsideBox(start, player.pos - start, boundary, path);
     
     // Side walls
     if (player.pos.x < -boundary) { player.pos.x = -boundary; player.vel.x = 0; }
@@ -356,156 +992,596 @@ void updateGame(float deltaTime)
     if (player.pos.y < -boundary) { player.pos.y = -boundary; player.vel.y = 0; }
     if (player.pos.y > boundary) { player.pos.y = boundary; player.vel.y = 0; }
 
-    // Check hazard collision
-    for (auto& hazard : hazards) {
-        hazard.pulseTimer += deltaTime;
-        float dist = glm::length(player.pos - hazard.pos);
-        if (dist < (player.radius + hazard.radius)) {
-            createExplosion(player.pos, player.color, 50);
+    levelTime += deltaTime;
+
+    // Check hazard collision along the path, only against hazards in the
+    // cells it crosses; the first one touched ends the level where it was hit
+    ProfileZone collisionZone(profiler, "collision");
+    for (int s = 0; s + 1 < corners; s++) {
+        float hitTime = -1.0f;
+        hazardGrid.querySwept(path[s], path[s + 1], player.radius, [&](int id) {
+            const Body& hazard = hazards.get<Body>(hazards.indexOf(id)); // hazards are never removed
+            float t = sweepSphereSphere(path[s], path[s + 1], player.radius, hazard.pos, hazard.radius);
+            if (t >= 0.0f && (hitTime < 0.0f || t < hitTime))
+                hitTime = t;
+            return false;
+        });
+        if (hitTime >= 0.0f) {
+            createExplosion(glm::mix(path[s], path[s + 1], hitTime), player.color, 50);
             resetGame(); // Game over, reset level
             return; // Stop update for this frame
         }
     }
 
-    // Check target collision
-    bool allCollected = true;
-    for (auto& target : targets) {
-        if (!target.collected) {
-            allCollected = false;
-            target.pulseTimer += deltaTime;
-            float dist = glm::length(player.pos - target.pos);
-            if (dist < (player.radius + target.radius)) {
-                target.collected = true;
+    // Check target collision along the path; the grid still lists collected
+    // targets, whose ids no longer map to anything
+    bool allCollected = targets.count == 0;
+    for (int s = 0; s + 1 < corners; s++) {
+        targetGrid.querySwept(path[s], path[s + 1], player.radius, [&](int id) {
+            int i = targets.indexOf(id);
+            if (i < 0)
+                return false;
+            Body body = targets.get<Body>(i);
+            if (sweepSphereSphere(path[s], path[s + 1], player.radius, body.pos, body.radius) >= 0.0f) {
+                glm::vec3 color = targets.get<Tint>(i).color;
+                targets.remove(id);
+                levelChanged = true;
                 score += 10;
-                createExplosion(target.pos, target.color, 30);
+                createExplosion(body.pos, color, 30);
             }
-        }
+            return false;
+        });
     }
 
     // Check for level complete
-    if (allCollected && !targets.empty()) {
+    if (allCollected) {
         level++;
         score += 100; // Level complete bonus
         spawnLevel(level); // Go to next level
     }
 
-    // Update particles
-    for (auto& p : particles) {
-        p.vel += gravity * deltaTime * 0.3f; // Particles are slightly affected by gravity
-        p.pos += p.vel * deltaTime;
-        p.life -= deltaTime;
-        p.size *= 0.98f;
-    }
+    collisionZone.end();
 
-    particles.erase(std::remove_if(particles.begin(), particles.end(),
-                    [](const Particle& p) { return p.life <= 0.0f; }), particles.end());
+    // Update particles, slightly affected by gravity
+    ProfileZone particleZone(profiler, "particles");
+    if (particleBackend == PARTICLES_GPU && gpuParticles)
+        gpuParticleCommand({ GpuParticleCommand::UPDATE, gravity * 0.3f, glm::vec3(0.0f), 0, deltaTime, 0 });
+    else
+        particles.update(gravity * 0.3f, deltaTime, jobs);
 }
 
 void spawnLevel(int level)
 {
-    // Clear old objects
-    targets.clear();
-    hazards.clear();
-    particles.clear();
+    float boundary = 0.8f;
+    std::shared_ptr<const LevelLayout> layout = takeLevelLayout(level);
+    int targetCount = (int)layout->targets.size();
+    int hazardCount = 2 * ((int)(2.0f * boundary / 0.15f) + 2) + (int)layout->hazards.size(); // a row top and bottom, plus slack
+
+    // Release the old level in one go and lay out the new one's columns
+    levelArena.reset(TargetArchetype::bytesFor(targetCount) + HazardArchetype::bytesFor(hazardCount));
+    targets.attach(levelArena, targetCount);
+    hazards.attach(levelArena, hazardCount);
+    clearParticles();
 
     // Reset player position
     player.pos = glm::vec3(0.0f, 0.0f, 0.0f);
+    player.prevPos = player.pos;
     player.vel = glm::vec3(0.0f, 0.0f, 0.0f);
     gravity = glm::vec3(0.0f, -0.6f, 0.0f); // Reset gravity
 
-    float boundary = 0.8f;
-
     // Add hazards to top and bottom
+    Tint hazardColor = { glm::vec3(1.0f, 0.2f, 0.2f) };
     for (float x = -boundary; x <= boundary; x += 0.15f) {
-        Hazard topHazard, bottomHazard;
-        topHazard.pos = glm::vec3(x, boundary - 0.05f, 0.0f);
-        topHazard.color = glm::vec3(1.0f, 0.2f, 0.2f);
-        topHazard.radius = 0.04f;
-        topHazard.pulseTimer = 0.0f;
-        
-        bottomHazard.pos = glm::vec3(x, -boundary + 0.05f, 0.0f);
-        bottomHazard.color = glm::vec3(1.0f, 0.2f, 0.2f);
-        bottomHazard.radius = 0.04f;
-        bottomHazard.pulseTimer = 0.0f;
-
-        hazards.push_back(topHazard);
-        hazards.push_back(bottomHazard);
+        hazards.create({ glm::vec3(x, boundary - 0.05f, 0.0f), 0.04f }, hazardColor);
+        hazards.create({ glm::vec3(x, -boundary + 0.05f, 0.0f), 0.04f }, hazardColor);
     }
-    
-    // Spawn targets
-    int targetCount = 2 + level; // Increase targets with level
-    float safeZone = 0.6f; // Spawn away from walls
-    
+
+    // Spawn targets, and on stress levels extra hazards, where the layout
+    // put them; z stays 0
+    Tint targetColor = { glm::vec3(0.2f, 1.0f, 0.2f) }; // Green
     for (int i = 0; i < targetCount; i++) {
-        Target target;
-        target.pos = glm::vec3(
-            ((float)rand() / RAND_MAX) * safeZone * 2.0f - safeZone,
-            ((float)rand() / RAND_MAX) * safeZone * 2.0f - safeZone,
-            0.0f // Ensure Z is 0
-        );
-        target.radius = 0.04f;
-        target.color = glm::vec3(0.2f, 1.0f, 0.2f); // Green
-        target.collected = false;
-        target.pulseTimer = (float)rand() / RAND_MAX * 5.0f;
-        targets.push_back(target);
+        Pulse pulse = { layout->targetPhases[i] };
+        targets.create({ glm::vec3(layout->targets[i], 0.0f), layout->radius }, targetColor, pulse);
+    }
+    for (const glm::vec2& pos : layout->hazards)
+        hazards.create({ glm::vec3(pos, 0.0f), layout->radius }, hazardColor);
+
+    // nothing has been removed yet, so column index == entity id
+    levelChanged = true;
+    levelGeneration++;
+    levelTime = 0.0f;
+    targetGrid.build(targets.column<Body>(), targets.count);
+    hazardGrid.build(hazards.column<Body>(), hazards.count);
+}
+
+// Blue-noise placement for a level: 2 + level targets, plus --stress extra
+// objects (half targets, half hazards), spread over the box inside the
+// hazard rows and clear of the spawn point. The spacing is picked so one
+// saturated PoissonDisk fill holds them all; on stress levels objects
+// shrink to half the spacing so they never overlap. Shuffling the fill
+// before taking from it keeps a partial level spread over the whole box.
+std::shared_ptr<const LevelLayout> generateLevelLayout(int level, int stressObjects, uint32_t seed)
+{
+    std::shared_ptr<LevelLayout> layout = std::make_shared<LevelLayout>();
+    layout->level = level;
+    layout->stressObjects = stressObjects;
+    layout->seed = seed;
+    int targetCount = 2 + level + (stressObjects + 1) / 2; // Increase targets with level
+    int hazardCount = stressObjects / 2;
+
+    const float extent = 0.67f; // hazard rows sit at +-0.75 with radius 0.04
+    float area = 4.0f * extent * extent;
+    // density(spacing) is density(1) / spacing^2
+    float spacing = std::min(0.25f, std::sqrt(area * PoissonDisk::density(1.0f) / (targetCount + hazardCount)));
+    layout->radius = std::min(0.04f, spacing * 0.5f);
+
+    Xorshift32 random(seed ^ (uint32_t)level * 0x9E3779B9u);
+    PoissonDisk disk(glm::vec2(-extent), glm::vec2(extent), spacing);
+    disk.keepOut(glm::vec2(0.0f), 0.2f); // keep the spawn point clear
+    disk.generate(random);
+    disk.shuffle(random);
+
+    int placed = std::min(targetCount, (int)disk.points.size());
+    layout->targets.assign(disk.points.begin(), disk.points.begin() + placed);
+    layout->hazards.assign(disk.points.begin() + placed, disk.points.begin() + std::min(placed + hazardCount, (int)disk.points.size()));
+    layout->targetPhases.resize(placed);
+    for (float& phase : layout->targetPhases)
+        phase = random.uniform() * 5.0f;
+    return layout;
+}
+
+// The layout for a level: the current one again when a level restarts,
+// level 1's kept from the start of the run on a reset, the one generated
+// ahead when the level moves on, and generated here only if none fits (the
+// first level, or a change of seed or --stress). Every new level starts
+// generating the one after it on a worker thread. A layout generated ahead
+// for a level that is not wanted any more is left to finish on its own
+// rather than waited for; waiting for or generating a layout here counts
+// as a miss, shown on the HUD and as a profiler zone.
+std::shared_ptr<const LevelLayout> takeLevelLayout(int level)
+{
+    auto fits = [level](const std::shared_ptr<const LevelLayout>& layout) {
+        return layout && layout->level == level && layout->stressObjects == stressObjects && layout->seed == rngSeed;
+    };
+    auto ready = [](const std::future<std::shared_ptr<const LevelLayout>>& future) {
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    if (fits(levelLayout))
+        return levelLayout;
+    staleLayouts.erase(std::remove_if(staleLayouts.begin(), staleLayouts.end(), ready), staleLayouts.end());
+
+    std::shared_ptr<const LevelLayout> layout = fits(firstLayout) ? firstLayout : NULL;
+    if (!layout && nextLayout.valid() && nextLayoutLevel == level) {
+        if (!ready(nextLayout)) {
+            ProfileZone zone(profiler, "level layout miss");
+            layoutMisses++;
+            nextLayout.wait();
+        }
+        layout = nextLayout.get();
+    }
+    if (!fits(layout)) {
+        ProfileZone zone(profiler, "level layout miss");
+        if (levelLayout)
+            layoutMisses++; // the run's first level can't be generated ahead
+        layout = generateLevelLayout(level, stressObjects, rngSeed);
     }
+    levelLayout = layout;
+    if (level == 1)
+        firstLayout = layout;
+
+    // a std::async future blocks in its destructor, so an unwanted one is
+    // parked until it finishes
+    if (nextLayout.valid())
+        staleLayouts.push_back(std::move(nextLayout));
+    nextLayoutLevel = level + 1;
+    nextLayout = std::async(std::launch::async, generateLevelLayout, level + 1, stressObjects, rngSeed);
+    return levelLayout;
 }
 
 void createExplosion(glm::vec3 pos, glm::vec3 color, int count)
 {
+    // On the GPU backend an explosion is just a queued emit command
+    if (particleBackend == PARTICLES_GPU && gpuParticles) {
+        gpuParticleCommand({ GpuParticleCommand::EMIT, pos, color, count, 0.0f, rand() });
+        return;
+    }
+
     for (int i = 0; i < count; i++) {
-        Particle p;
-        p.pos = pos;
         float angle = ((float)rand() / RAND_MAX) * 6.28f; // 2D circle
         float speed = ((float)rand() / RAND_MAX) * 1.0f + 0.2f;
-        p.vel = glm::vec3(
+        glm::vec3 vel(
             cos(angle) * speed,
             sin(angle) * speed,
             0.0f // 2D only
         );
-        p.color = color;
-        p.life = 1.0f + (float)rand() / RAND_MAX;
-        p.size = 0.03f;
-        particles.push_back(p);
+        float life = 1.0f + (float)rand() / RAND_MAX;
+        if (!particles.emit(pos, vel, color, life, 0.03f))
+            break; // pool is full
+    }
+}
+
+void clearParticles()
+{
+    particles.clear();
+    if (gpuParticles)
+        gpuParticleCommand({ GpuParticleCommand::CLEAR, glm::vec3(0.0f), glm::vec3(0.0f), 0, 0.0f, 0 });
+}
+
+// Runs a GpuParticleSystem call now, or queues it for the render thread
+// while the simulation runs on its own thread
+void gpuParticleCommand(const GpuParticleCommand& command)
+{
+    if (queueGpuCommands) {
+        std::lock_guard<std::mutex> guard(gpuCommandLock);
+        gpuCommands.push_back(command);
+        return;
+    }
+    executeGpuParticleCommand(command);
+}
+
+void executeGpuParticleCommand(const GpuParticleCommand& command)
+{
+    switch (command.type) {
+    case GpuParticleCommand::EMIT:   gpuParticles->emit(command.pos, command.color, command.count, command.seed); break;
+    case GpuParticleCommand::UPDATE: gpuParticles->update(command.pos, command.deltaTime); break;
+    case GpuParticleCommand::CLEAR:  gpuParticles->clear(); break;
     }
 }
 
-void drawCube(unsigned int shaderProgram, unsigned int VAO, glm::mat4 view, glm::mat4 projection)
+// Render thread: replays everything the simulation queued since last frame
+void runGpuParticleCommands()
+{
+    std::vector<GpuParticleCommand> pending;
+    {
+        std::lock_guard<std::mutex> guard(gpuCommandLock);
+        pending.swap(gpuCommands);
+    }
+    for (const GpuParticleCommand& command : pending)
+        executeGpuParticleCommand(command);
+}
+
+void drawCube(RenderQueue& queue, const CubeShader& shader, unsigned int VAO, glm::mat4 view, glm::mat4 projection)
 {
     // Draw a static, non-rotating cube
     glm::mat4 model = glm::mat4(1.0f);
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    DrawCall cube = DrawCall();
+    cube.program = shader.program;
+    cube.vao = VAO;
+    cube.primitive = GL_LINES;
+    cube.count = 24;
+    cube.instances = 1;
+    queue.push(RenderQueue::makeKey(RENDER_PASS_OPAQUE, shader.program, VAO, 0.0f), cube);
+
+    // the queue only uploads the ones that changed since last frame
+    queue.uniform(shader.model, GL_FLOAT_MAT4, glm::value_ptr(model));
+    queue.uniform(shader.view, GL_FLOAT_MAT4, glm::value_ptr(view));
+    queue.uniform(shader.projection, GL_FLOAT_MAT4, glm::value_ptr(projection));
 
     glm::vec3 cubeColor = glm::vec3(0.3f, 0.7f, 1.0f);
-    glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, glm::value_ptr(cubeColor));
-    glUniform1f(glGetUniformLocation(shaderProgram, "alpha"), 0.6f);
+    float cubeAlpha = 0.6f;
+    queue.uniform(shader.color, GL_FLOAT_VEC3, glm::value_ptr(cubeColor));
+    queue.uniform(shader.alpha, GL_FLOAT, &cubeAlpha);
+}
 
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_LINES, 0, 24);
+void drawSphere(SphereRenderer& renderer, glm::vec3 pos, float radius, glm::vec3 color, float alpha)
+{
+    // Queued into the current batch; drawn on the next flush()
+    renderer.add(pos, radius, color, alpha);
 }
 
-void drawSphere(unsigned int shaderProgram, unsigned int sphereVAO, int sphereVertexCount,
-                glm::vec3 pos, float radius, glm::vec3 color, float alpha, glm::mat4 view, glm::mat4 projection)
+#ifndef GRAVITY_BOX_HEADLESS
+// Renders 1k/10k/100k particle-sized spheres with both draw modes and prints
+// the average frames per second of each. Run with --bench-spheres.
+void runSphereBenchmark(GLFWwindow* window, SphereRenderer& renderer, glm::mat4 view, glm::mat4 projection)
 {
-    // Model matrix now only translates and scales. No rotation.
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, pos);
-    model = glm::scale(model, glm::vec3(radius));
+    const int counts[] = { 1000, 10000, 100000 };
+    const int frames = 30;
+    glfwSwapInterval(0); // measure the renderer, not the display
+
+    ParticlePool bench(counts[2]);
+    std::cout << "particles   mesh fps   impostor fps" << std::endl;
+    for (int count : counts) {
+        bench.clear();
+        for (int i = 0; i < count; i++) {
+            glm::vec3 pos(((float)rand() / RAND_MAX) * 1.6f - 0.8f,
+                          ((float)rand() / RAND_MAX) * 1.6f - 0.8f,
+                          0.0f);
+            bench.emit(pos, glm::vec3(0.0f), glm::vec3(1.0f, 1.0f, 0.0f),
+                       1.0f + (float)rand() / RAND_MAX, 0.03f * ((float)rand() / RAND_MAX * 0.8f + 0.2f));
+        }
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "color"), 1, glm::value_ptr(color));
-    glUniform1f(glGetUniformLocation(shaderProgram, "alpha"), alpha);
+        double fps[2];
+        SphereDrawMode modes[2] = { SPHERE_MESH, SPHERE_IMPOSTOR };
+        for (int m = 0; m < 2; m++) {
+            glFinish();
+            double start = glfwGetTime();
+            for (int f = 0; f < frames; f++) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.beginFrame(view, projection, SCR_HEIGHT);
+                for (int i = 0; i < bench.count; i++)
+                    drawSphere(renderer, bench.position(i), bench.size[i], bench.color(i), bench.life[i] / 2.0f);
+                renderer.flush(modes[m]);
+                glfwSwapBuffers(window);
+            }
+            glFinish();
+            fps[m] = frames / (glfwGetTime() - start);
+        }
+        printf("%9d   %8.1f   %12.1f\n", count, fps[0], fps[1]);
+    }
+}
+#endif
 
-    glBindVertexArray(sphereVAO);
-    glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
+// Times ParticlePool::update() on 1M and 4M live particles at 60 Hz steps and
+// prints the average and worst frame. Run with --bench-particles.
+void runParticleBenchmark()
+{
+    const int counts[] = { 1 << 20, 1 << 22 };
+    const int frames = 120;
+    const float dt = 1.0f / 60.0f;
+
+    std::cout << "SIMD width: " << PARTICLE_SIMD_WIDTH << std::endl;
+    std::cout << "particles   avg ms   max ms" << std::endl;
+    for (int count : counts) {
+        ParticlePool pool(count);
+        for (int i = 0; i < count; i++) {
+            float angle = ((float)rand() / RAND_MAX) * 6.28f;
+            float speed = ((float)rand() / RAND_MAX) * 1.0f + 0.2f;
+            // long lives so the pool stays near full for the whole run
+            pool.emit(glm::vec3(0.0f), glm::vec3(cos(angle) * speed, sin(angle) * speed, 0.0f),
+                      glm::vec3(1.0f, 1.0f, 0.0f), 1.0f + ((float)rand() / RAND_MAX) * 4.0f, 0.03f);
+        }
+
+        double total = 0.0, worst = 0.0;
+        for (int f = 0; f < frames; f++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            pool.update(gravity * 0.3f, dt);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            total += ms;
+            worst = std::max(worst, ms);
+        }
+        printf("%9d   %6.2f   %6.2f\n", count, total / frames, worst);
+    }
+}
+
+#ifndef GRAVITY_BOX_HEADLESS
+// A/B timing of the CPU and GPU particle backends: the same bursts are
+// emitted into each, then simulated and drawn for a fixed number of frames.
+// Prints the average update and whole-frame cost. Run with
+// --bench-particle-backends.
+void runParticleBackendBenchmark(GLFWwindow* window, SphereRenderer& renderer, glm::mat4 view, glm::mat4 projection)
+{
+    const int counts[] = { 1000, 10000, 60000 };
+    const int frames = 60;
+    const float dt = 1.0f / 60.0f;
+    glfwSwapInterval(0);
+
+    ParticlePool pool(counts[2]);
+    std::cout << "particles   cpu update ms   cpu frame ms   gpu update ms   gpu frame ms" << std::endl;
+    for (int count : counts) {
+        double updateMs[2], frameMs[2];
+        for (int backend = 0; backend < 2; backend++) {
+            pool.clear();
+            gpuParticles->clear();
+            // bursts of 1000 like a very busy level
+            for (int emitted = 0; emitted < count; emitted += 1000) {
+                glm::vec3 origin(((float)rand() / RAND_MAX) * 1.2f - 0.6f, ((float)rand() / RAND_MAX) * 1.2f - 0.6f, 0.0f);
+                if (backend == PARTICLES_GPU) {
+                    gpuParticles->emit(origin, glm::vec3(1.0f, 1.0f, 0.0f), 1000, rand());
+                    gpuParticles->update(gravity * 0.3f, 0.0f); // flush the commands before the next batch
+                } else {
+                    for (int i = 0; i < 1000; i++) {
+                        float angle = ((float)rand() / RAND_MAX) * 6.28f;
+                        float speed = ((float)rand() / RAND_MAX) * 1.0f + 0.2f;
+                        pool.emit(origin, glm::vec3(cos(angle) * speed, sin(angle) * speed, 0.0f),
+                                  glm::vec3(1.0f, 1.0f, 0.0f), 1.0f + (float)rand() / RAND_MAX, 0.03f);
+                    }
+                }
+            }
+
+            glFinish();
+            double updateTotal = 0.0;
+            double start = glfwGetTime();
+            for (int f = 0; f < frames; f++) {
+                double updateStart = glfwGetTime();
+                if (backend == PARTICLES_GPU) {
+                    gpuParticles->update(gravity * 0.3f, dt);
+                    glFinish(); // wait for the pass so its cost is attributed here
+                } else {
+                    pool.update(gravity * 0.3f, dt);
+                }
+                updateTotal += glfwGetTime() - updateStart;
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.beginFrame(view, projection, SCR_HEIGHT);
+                if (backend == PARTICLES_GPU) {
+                    renderer.drawInstanceBuffer(gpuParticles->stateBuffer(), sizeof(GpuParticle),
+                                                gpuParticles->slotCount(), SPHERE_IMPOSTOR);
+                } else {
+                    for (int i = 0; i < pool.count; i++)
+                        drawSphere(renderer, pool.position(i), pool.size[i], pool.color(i), pool.life[i] / 2.0f);
+                    renderer.flush(SPHERE_IMPOSTOR);
+                }
+                glfwSwapBuffers(window);
+            }
+            glFinish();
+            updateMs[backend] = updateTotal * 1000.0 / frames;
+            frameMs[backend] = (glfwGetTime() - start) * 1000.0 / frames;
+        }
+        printf("%9d   %13.2f   %12.2f   %13.2f   %12.2f\n", count, updateMs[0], frameMs[0], updateMs[1], frameMs[1]);
+    }
+}
+
+// Draws the same translucent impostor particles, spread through the box in
+// depth, unsorted, sorted back to front on the CPU and with weighted blended
+// OIT, and prints the average frame cost of each (the sorted column includes
+// the sort) plus the CPU time the sorted flush takes on its own. Run with
+// --bench-transparency.
+void runTransparencyBenchmark(GLFWwindow* window, SphereRenderer& renderer, WeightedBlendedOIT& oit, glm::mat4 view, glm::mat4 projection)
+{
+    const int counts[] = { 1000, 10000, 50000 };
+    const int frames = 30;
+    glfwSwapInterval(0);
+    if (!oit.complete)
+        std::cout << "weighted OIT unavailable, its column repeats unsorted" << std::endl;
+
+    ParticlePool bench(counts[2]);
+    std::cout << "particles   unsorted ms   sorted ms   sort cpu ms   oit ms" << std::endl;
+    for (int count : counts) {
+        bench.clear();
+        for (int i = 0; i < count; i++) {
+            glm::vec3 pos(((float)rand() / RAND_MAX) * 1.6f - 0.8f,
+                          ((float)rand() / RAND_MAX) * 1.6f - 0.8f,
+                          ((float)rand() / RAND_MAX) * 1.6f - 0.8f);
+            bench.emit(pos, glm::vec3(0.0f), glm::vec3((float)rand() / RAND_MAX, 1.0f, 0.0f),
+                       0.4f + (float)rand() / RAND_MAX, 0.03f * ((float)rand() / RAND_MAX * 0.8f + 0.2f));
+        }
+
+        double frameMs[3], sortMs = 0.0;
+        TransparencyMode modes[3] = { TRANSPARENCY_UNSORTED, TRANSPARENCY_SORTED, TRANSPARENCY_WEIGHTED };
+        for (int m = 0; m < 3; m++) {
+            bool weighted = modes[m] == TRANSPARENCY_WEIGHTED && oit.complete;
+            renderer.transparency = weighted || modes[m] != TRANSPARENCY_WEIGHTED ? modes[m] : TRANSPARENCY_UNSORTED;
+            double flushTotal = 0.0;
+            glFinish();
+            double start = glfwGetTime();
+            for (int f = 0; f < frames; f++) {
+                if (weighted)
+                    oit.beginScene();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer.beginFrame(view, projection, SCR_HEIGHT);
+                if (weighted)
+                    oit.beginTransparent();
+                for (int i = 0; i < bench.count; i++)
+                    drawSphere(renderer, bench.position(i), bench.size[i], bench.color(i), bench.life[i] / 2.0f);
+                double flushStart = glfwGetTime();
+                renderer.flush(SPHERE_IMPOSTOR, NULL, RENDER_PASS_TRANSPARENT);
+                flushTotal += glfwGetTime() - flushStart;
+                if (weighted) {
+                    oit.resolve();
+                    oit.present();
+                }
+                glfwSwapBuffers(window);
+            }
+            glFinish();
+            frameMs[m] = (glfwGetTime() - start) * 1000.0 / frames;
+            if (modes[m] == TRANSPARENCY_SORTED)
+                sortMs = flushTotal * 1000.0 / frames;
+        }
+        printf("%9d   %11.2f   %9.2f   %11.2f   %6.2f\n", count, frameMs[0], frameMs[1], sortMs, frameMs[2]);
+    }
+    renderer.transparency = TRANSPARENCY_UNSORTED;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
-}
\ No newline at end of file
+}
+#endif
+
+// Runs the simulation for a number of ticks without a window or GL context,
+// driven by a fixed input script and a fixed seed so every run is the same.
+// Prints throughput, tick-time percentiles and the particle high-water mark.
+// Run with --headless [N] (optionally with --tick-rate, --stress, --record or
+// --replay; N = 0 replays the whole recording).
+void runHeadless(int ticks)
+{
+    if (replay && (ticks <= 0 || (uint64_t)ticks > replay->endTick))
+        ticks = (int)replay->endTick; // 0 means the whole recording
+    level = 1;
+    spawnLevel(level);
+    resetGame();
+
+    std::vector<double> tickMs;
+    tickMs.reserve(ticks);
+    int peakParticles = 0;
+
+    auto runStart = std::chrono::high_resolution_clock::now();
+    for (int t = 0; t < ticks; t++) {
+        // (stepGame() swaps in the recorded input when replaying)
+        auto start = std::chrono::high_resolution_clock::now();
+        stepGame(scriptedInput(t));
+        tickMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        peakParticles = std::max(peakParticles, particles.count);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStart).count();
+
+    std::sort(tickMs.begin(), tickMs.end());
+    double p50 = tickMs.empty() ? 0.0 : tickMs[tickMs.size() / 2];
+    double p99 = tickMs.empty() ? 0.0 : tickMs[std::min(tickMs.size() - 1, tickMs.size() * 99 / 100)];
+    printf("ticks: %d at %.0f Hz (%.1f s of game time)\n", ticks, timestep.tickRate, ticks * timestep.dt);
+    printf("ticks/s: %.0f   p50 ms: %.4f   p99 ms: %.4f   peak particles: %d\n",
+           ticks / seconds, p50, p99, peakParticles);
+    printf("final level: %d   score: %d   layout misses: %d   state hash: %08x\n", level, score, layoutMisses, stateHash());
+}
+
+// The fixed input pattern of headless runs: sweep left, pause, sweep right
+// every three seconds, and flip gravity every 0.7 s so the ball keeps
+// crossing the box
+PlayerInput scriptedInput(int tick)
+{
+    const int ticksPerSecond = (int)timestep.tickRate;
+    PlayerInput scripted;
+    scripted.moveX = (tick / (ticksPerSecond + 1)) % 3 - 1;
+    scripted.flipGravity = tick % (ticksPerSecond * 7 / 10 + 1) == 0;
+    scripted.reset = false;
+    scripted.switchBackend = false;
+    return scripted;
+}
+
+// Runs one second of the headless simulation with 1M live particles on 1, 2,
+// 4 ... maxThreads threads and prints ticks per second and the speedup over
+// one thread. The state hash must not change with the thread count. Run
+// with --bench-jobs [maxThreads].
+void runJobBenchmark(int maxThreads)
+{
+    const int particleCount = 1 << 20;
+    const int ticks = 120;
+    if (maxThreads < 1) maxThreads = 1;
+    particles.resize(particleCount);
+
+    std::cout << "threads    ticks/s   ms/tick   speedup   state hash" << std::endl;
+    double baseline = 0.0;
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        srand(1);
+        level = 1;
+        spawnLevel(level);
+        resetGame();
+        simTick = 0;
+        for (int i = 0; i < particleCount; i++) {
+            float angle = ((float)rand() / RAND_MAX) * 6.28f;
+            float speed = ((float)rand() / RAND_MAX) * 1.0f + 0.2f;
+            // lives run past the end of the run so the load stays constant
+            particles.emit(glm::vec3(0.0f), glm::vec3(cos(angle) * speed, sin(angle) * speed, 0.0f),
+                           glm::vec3(1.0f, 1.0f, 0.0f), 2.0f + (float)rand() / RAND_MAX, 0.03f);
+        }
+
+        JobSystem pool(threads - 1);
+        jobs = &pool;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int t = 0; t < ticks; t++)
+            stepGame(scriptedInput(t));
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        jobs = NULL;
+
+        double rate = ticks / seconds;
+        if (threads == 1) baseline = rate;
+        printf("%7d   %8.0f   %7.3f   %6.2fx   %08x\n", threads, rate, seconds * 1000.0 / ticks, rate / baseline, stateHash());
+        if (threads == maxThreads)
+            break;
+    }
+}
+
+// Generates level layouts with 10k to 4M stress objects and prints how long
+// each took and how many objects fitted. Run with --bench-levels.
+void runLevelBenchmark()
+{
+    const int counts[] = { 10000, 100000, 1000000, 4000000 };
+    std::cout << "objects     placed      ms" << std::endl;
+    for (int count : counts) {
+        auto start = std::chrono::high_resolution_clock::now();
+        std::shared_ptr<const LevelLayout> layout = generateLevelLayout(1, count, 1);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        printf("%7d   %8d   %5.0f\n", count, (int)(layout->targets.size() + layout->hazards.size()), ms);
+    }
+}
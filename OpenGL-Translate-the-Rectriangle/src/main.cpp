@@ -9,26 +9,9 @@
 #include "glm/glm/gtc/type_ptr.hpp"
 
 #include "shader_m.h"
+#include "shader_watcher.h"
 #include <iostream>
 
-const char* vertexShaderSource = "#version 330 core\n"
-"layout (location = 0) in vec3 aPos;\n"
-"uniform mat4 transform;\n"
-"void main()\n"
-"{\n"
-"   gl_Position = transform * vec4(aPos, 1.0);\n"
-"}\0";
-
-const char* fragmentShaderSource = "#version 330 core\n"
-"out vec4 FragColor;\n"
-"uniform vec3 color;\n"
-"void main()\n"
-"{\n"
-"   FragColor = vec4(color, 1.0);\n"
-"}\0";
-
-
-
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
 
@@ -58,43 +41,22 @@ int main()
         return -1;
     }
 
-    // Compile vertex shader
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Compile fragment shader
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
+    // lets the driver compile reloaded shaders on its own threads
+    enableParallelShaderCompile((GLADloadproc)glfwGetProcAddress);
+    // linked programs are kept in shader_cache/, so later runs (and
+    // reloads back to an earlier version) skip the compile
+    ProgramCache programCache("shader_cache");
+    ProgramCache::current = &programCache;
 
-    // Link shaders
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
+    // The shaders are read from resources/shaders, and reloaded while the
+    // demo runs whenever one of them is saved (Linux)
+    Shader shader("resources/shaders/translate.vs", "resources/shaders/translate.fs");
+    ShaderWatcher watcher;
+    watcher.watch(shader);
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Resolve the uniforms once instead of looking them up every frame
+    Uniform<glm::mat4> transformUniform = shader.uniform<glm::mat4>("transform");
+    Uniform<glm::vec3> colorUniform = shader.uniform<glm::vec3>("color");
 
     // New: 6 vertices for 2 triangles (no EBO)
     float vertices[] = {
@@ -128,7 +90,12 @@ int main()
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        glUseProgram(shaderProgram);
+        // a reloaded program has its own uniform locations
+        if (watcher.update() > 0) {
+            transformUniform = shader.uniform<glm::mat4>("transform");
+            colorUniform = shader.uniform<glm::vec3>("color");
+        }
+        shader.use();
 
         float timeValue = glfwGetTime();
 float xOffset = sin(timeValue) * 0.5f;
@@ -142,14 +109,12 @@ transform = glm::translate(transform, glm::vec3(xOffset, yOffset, 0.0f));
 
 
 
-        unsigned int transformLoc = glGetUniformLocation(shaderProgram, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(transform));//1 matrix, no transpose needed
+        transformUniform.set(transform);
 
         // --- New: color animation (green → black → green)
         float intensity = fabs(sin(timeValue)); // goes 0 → 1 → 0
         glm::vec3 color(0.0f, intensity, 0.0f); // green intensity
-        unsigned int colorLoc = glGetUniformLocation(shaderProgram, "color");
-        glUniform3fv(colorLoc, 1, glm::value_ptr(color));
+        colorUniform.set(color);
 
 
         glBindVertexArray(VAO);
@@ -161,7 +126,7 @@ transform = glm::translate(transform, glm::vec3(xOffset, yOffset, 0.0f));
 
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteProgram(shader.ID);
 
     glfwTerminate();
     return 0;
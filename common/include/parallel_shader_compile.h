@@ -0,0 +1,58 @@
+#ifndef PARALLEL_SHADER_COMPILE_H
+#define PARALLEL_SHADER_COMPILE_H
+
+#include "glad.h"
+
+#include <cstring>
+
+// KHR_parallel_shader_compile (ARB_ has the same enums and entry point) is
+// not in the generated loader, so its pieces are declared here
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Whether the driver compiles and links on its own threads, and reports
+// when it is done through GL_COMPLETION_STATUS_KHR. Without it a driver may
+// still compile in the background, but only a status query finds out, and
+// that query waits for the result.
+struct ParallelShaderCompile {
+    static inline bool available = false;
+};
+
+// looks for the extension and, if present, lets the driver use as many
+// compiler threads as it likes; call once after loading GL
+// ------------------------------------------------------------------------
+inline bool enableParallelShaderCompile(GLADloadproc load)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    const char* entryPoint = NULL;
+    for (GLint i = 0; i < count && !entryPoint; i++) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0)
+            entryPoint = "glMaxShaderCompilerThreadsKHR";
+        else if (strcmp(name, "GL_ARB_parallel_shader_compile") == 0)
+            entryPoint = "glMaxShaderCompilerThreadsARB";
+    }
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = entryPoint ? (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load(entryPoint) : NULL;
+    if (maxThreads)
+        maxThreads(0xFFFFFFFFu); // implementation-chosen thread count
+    ParallelShaderCompile::available = maxThreads != NULL;
+    return ParallelShaderCompile::available;
+}
+
+// true if a status query on the program would not wait: the driver says
+// the link has finished, or it cannot say and the query is as good as any
+// ------------------------------------------------------------------------
+inline bool programBuildFinished(unsigned int program)
+{
+    if (!ParallelShaderCompile::available)
+        return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+#endif
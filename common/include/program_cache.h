@@ -0,0 +1,262 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "glad.h"
+#include "shader_source.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+// Counters since the cache was created
+struct ProgramCacheStats {
+    int hits;     // programs loaded from a binary
+    int misses;   // no binary yet; compiled from source
+    int rejected; // binary stale or refused by the driver; deleted and recompiled
+    int stores;   // binaries written
+    int pruned;   // unreadable, or least recently used past the size cap; deleted when the cache opened
+};
+
+// On-disk cache of linked program binaries (GL 4.1 / ARB_get_program_binary).
+// A program is keyed by a 64-bit FNV-1a hash of its shader sources together
+// with the GL vendor, renderer and version strings, and stored as
+// <directory>/<key>.bin:
+//
+//   "GBPB" | version u32 | key u64 | driver hash u64 | format u32 | length u32 | binary
+//
+// A driver update changes the key, so its programs simply miss. The old
+// driver's files stay, for a machine that switches back (another GPU, or a
+// driver downgrade); instead the directory is kept under maxBytes when the
+// cache opens, deleting the least recently used binaries first (a hit
+// touches its file). A file whose header does not match, or whose binary
+// the driver refuses, is deleted and the program is compiled (and stored)
+// again. Without driver support every load() misses and store() does
+// nothing.
+class ProgramCache
+{
+public:
+    std::string directory;
+    uintmax_t maxBytes; // the directory is pruned down to this when the cache opens
+    bool enabled; // the driver can hand out and take back binaries
+    ProgramCacheStats stats;
+
+    // where buildProgram() looks; NULL compiles every time
+    static inline ProgramCache* current = NULL;
+
+    ProgramCache(const char* directory, uintmax_t maxBytes = 64u << 20)
+    {
+        this->directory = directory;
+        this->maxBytes = maxBytes;
+        stats = ProgramCacheStats();
+        driverHash = FNV_OFFSET;
+        const GLubyte* strings[3] = { glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION) };
+        for (const GLubyte* s : strings)
+            driverHash = hash(driverHash, s ? (const char*)s : "", s ? strlen((const char*)s) + 1 : 1);
+        GLint formats = 0;
+        if (GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        enabled = formats > 0;
+        if (enabled) {
+            std::error_code error;
+            std::filesystem::create_directories(this->directory, error);
+            if (error) {
+                std::cout << "ERROR::PROGRAM_CACHE::DIRECTORY " << this->directory << ": " << error.message() << std::endl;
+                enabled = false;
+            }
+        }
+        if (enabled)
+            prune();
+    }
+
+    // the key of a program built from these sources, one per stage; a stage
+    // that ShaderSourceCache resolved hashes piece by piece where it lies,
+    // to the same key as its joined text would
+    // ------------------------------------------------------------------------
+    uint64_t key(const char* const* sources, int count) const
+    {
+        uint64_t h = driverHash;
+        for (int i = 0; i < count; i++)
+            h = hash(h, sources[i], strlen(sources[i]) + 1); // the terminator separates stages
+        return h;
+    }
+    uint64_t key(const ShaderSource* const* stages, int count) const
+    {
+        uint64_t h = driverHash;
+        for (int i = 0; i < count; i++) {
+            stages[i]->forEachPiece([&h](const char* text, GLint length) { h = hash(h, text, length); });
+            h = hash(h, "", 1);
+        }
+        return h;
+    }
+    // a linked program for these sources, or 0 if there is no usable binary
+    // ------------------------------------------------------------------------
+    unsigned int load(const char* const* sources, int count)
+    {
+        return load(key(sources, count));
+    }
+    unsigned int load(uint64_t k)
+    {
+        if (!enabled)
+            return 0;
+        std::string path = pathFor(k);
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            stats.misses++;
+            return 0;
+        }
+        Header header;
+        file.read((char*)&header, sizeof(header));
+        std::vector<char> binary(file && header.length < (64u << 20) ? header.length : 0);
+        if (!binary.empty())
+            file.read(binary.data(), binary.size());
+        bool valid = file && memcmp(header.magic, "GBPB", 4) == 0 && header.version == VERSION &&
+                     header.key == k && header.driver == driverHash && !binary.empty();
+        file.close();
+
+        unsigned int program = 0;
+        if (valid) {
+            program = glCreateProgram();
+            glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+            GLint linked = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+            if (!linked) {
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        if (!program) {
+            std::remove(path.c_str());
+            stats.rejected++;
+            return 0;
+        }
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        stats.hits++;
+        return program;
+    }
+    // writes a program that was linked after prepare() under these sources
+    // ------------------------------------------------------------------------
+    void store(const char* const* sources, int count, unsigned int program)
+    {
+        store(key(sources, count), program);
+    }
+    void store(uint64_t k, unsigned int program)
+    {
+        if (!enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        Header header;
+        memcpy(header.magic, "GBPB", 4);
+        header.version = VERSION;
+        header.key = k;
+        header.driver = driverHash;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, NULL, &format, binary.data());
+        header.format = format;
+        header.length = (uint32_t)length;
+
+        // written aside and renamed, so a crash never leaves half a binary
+        std::string path = pathFor(header.key), temporary = path + ".tmp";
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), binary.size());
+        file.close();
+        std::error_code error;
+        if (file)
+            std::filesystem::rename(temporary, path, error);
+        if (!file || error) {
+            std::remove(temporary.c_str());
+            return;
+        }
+        stats.stores++;
+    }
+    // asks the driver to keep the binary retrievable; call before linking
+    // ------------------------------------------------------------------------
+    void prepare(unsigned int program) const
+    {
+        if (enabled)
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+private:
+    static const uint32_t VERSION = 1;
+    static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    uint64_t driverHash;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t driver;
+        uint32_t format;
+        uint32_t length;
+    };
+
+    // deletes temporaries a crash left behind and binaries no driver can
+    // use, judged by their header, then the least recently used binaries
+    // until the rest fit in maxBytes
+    void prune()
+    {
+        struct Binary {
+            std::filesystem::path path;
+            std::filesystem::file_time_type used;
+            uintmax_t bytes;
+        };
+        std::error_code error;
+        std::vector<std::filesystem::path> stale;
+        std::vector<Binary> kept;
+        uintmax_t total = 0;
+        for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+            const std::filesystem::path& path = it->path();
+            if (path.extension() == ".tmp") {
+                stale.push_back(path);
+                continue;
+            }
+            if (path.extension() != ".bin")
+                continue;
+            Header header;
+            std::ifstream file(path, std::ios::binary);
+            file.read((char*)&header, sizeof(header));
+            std::error_code statError;
+            Binary binary = { path, it->last_write_time(statError), it->file_size(statError) };
+            if (!file || memcmp(header.magic, "GBPB", 4) != 0 || header.version != VERSION || statError) {
+                stale.push_back(path);
+                continue;
+            }
+            kept.push_back(binary);
+            total += binary.bytes;
+        }
+        std::sort(kept.begin(), kept.end(), [](const Binary& a, const Binary& b) { return a.used < b.used; });
+        for (size_t i = 0; i < kept.size() && total > maxBytes; i++) {
+            stale.push_back(kept[i].path);
+            total -= kept[i].bytes;
+        }
+        for (const std::filesystem::path& path : stale)
+            if (std::filesystem::remove(path, error))
+                stats.pruned++;
+    }
+    static uint64_t hash(uint64_t h, const char* data, size_t bytes)
+    {
+        for (size_t i = 0; i < bytes; i++)
+            h = (h ^ (unsigned char)data[i]) * 1099511628211ull;
+        return h;
+    }
+    std::string pathFor(uint64_t key) const
+    {
+        char name[24];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return (std::filesystem::path(directory) / name).string();
+    }
+};
+
+#endif
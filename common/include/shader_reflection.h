@@ -0,0 +1,232 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include "glad.h"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <iostream>
+
+// One active uniform or vertex attribute of a linked program
+struct ShaderVariable {
+    std::string name; // as GL reports it, e.g. "lights[1].color" or "offsets[0]"
+    GLint location;
+    GLenum type;      // GL_FLOAT_VEC3, GL_SAMPLER_2D, ...
+    GLint size;       // array length, 1 for plain variables
+};
+
+// glUniform* for each C++ type a Uniform<T> can hold, and the GL types it
+// may be set on. Specialized here for scalars; shader_m.h adds the glm types.
+template <typename T> struct UniformSetter;
+
+template <> struct UniformSetter<bool> {
+    static void set(GLint location, bool value) { glUniform1i(location, (int)value); }
+    static bool accepts(GLenum type) { return type == GL_BOOL; }
+};
+template <> struct UniformSetter<int> {
+    static void set(GLint location, int value) { glUniform1i(location, value); }
+    static bool accepts(GLenum type)
+    {
+        return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE;
+    }
+};
+template <> struct UniformSetter<float> {
+    static void set(GLint location, float value) { glUniform1f(location, value); }
+    static bool accepts(GLenum type) { return type == GL_FLOAT; }
+};
+
+// A uniform of one program, resolved when the program was reflected, so
+// set() is a single glUniform* call: no name, no lookup, no GL query. The
+// program must be current. A uniform the program does not have (or that
+// the compiler optimized out) gets location -1, which GL silently ignores.
+template <typename T>
+struct Uniform {
+    GLint location;
+
+    Uniform() : location(-1) {}
+    explicit Uniform(GLint location) : location(location) {}
+
+    bool valid() const { return location >= 0; }
+    void set(const T& value) const { UniformSetter<T>::set(location, value); }
+};
+
+// Every active uniform and attribute of a linked program, read once with
+// glGetActiveUniform/glGetActiveAttrib into flat arrays. Each array has an
+// open-addressing index keyed by an FNV-1a hash of the name, so a lookup
+// by name is a hash and a strcmp or two, with no allocation and no GL call.
+// An array of basic types is reported (and found) as "offsets[0]" and may
+// also be found as "offsets"; any other uniform name, such as another
+// element "offsets[3]", is asked of GL once and the answer kept.
+// Uniforms in uniform blocks have no location and are left out.
+class ShaderReflection
+{
+public:
+    std::vector<ShaderVariable> uniforms;
+    std::vector<ShaderVariable> attributes;
+
+    ShaderReflection() : program(0) {}
+    explicit ShaderReflection(unsigned int program) { reflect(program); }
+
+    // (re)reads the program's interface; call after every successful link
+    // ------------------------------------------------------------------------
+    void reflect(unsigned int program)
+    {
+        this->program = program;
+        resolved.clear();
+        uniforms.clear();
+        attributes.clear();
+        GLint count = 0, longest = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+        std::vector<char> name(longest > 0 ? longest : 1);
+        for (GLint i = 0; i < count; i++) {
+            ShaderVariable v;
+            glGetActiveUniform(program, i, (GLsizei)name.size(), NULL, &v.size, &v.type, name.data());
+            v.location = glGetUniformLocation(program, name.data());
+            if (v.location < 0)
+                continue; // block member
+            v.name = name.data();
+            uniforms.push_back(v);
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+        glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &longest);
+        name.resize(longest > 0 ? longest : 1);
+        for (GLint i = 0; i < count; i++) {
+            ShaderVariable v;
+            glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &v.size, &v.type, name.data());
+            v.location = glGetAttribLocation(program, name.data());
+            if (v.location < 0)
+                continue; // built-ins such as gl_VertexID
+            v.name = name.data();
+            attributes.push_back(v);
+        }
+
+        buildIndex(uniforms, uniformIndex);
+        buildIndex(attributes, attributeIndex);
+    }
+    // NULL if the program has no such active variable
+    // ------------------------------------------------------------------------
+    const ShaderVariable* uniform(const char* name) const
+    {
+        const ShaderVariable* v = find(uniforms, uniformIndex, name);
+        return v ? v : resolve(name);
+    }
+    const ShaderVariable* attribute(const char* name) const { return find(attributes, attributeIndex, name); }
+    // ------------------------------------------------------------------------
+    GLint uniformLocation(const char* name) const
+    {
+        const ShaderVariable* v = uniform(name);
+        return v ? v->location : -1;
+    }
+    GLint attributeLocation(const char* name) const
+    {
+        const ShaderVariable* v = attribute(name);
+        return v ? v->location : -1;
+    }
+    // a typed handle to a uniform; resolve once (e.g. next to the program)
+    // and keep it. Reports a C++ type that does not match the GLSL one,
+    // where the type is known.
+    // ------------------------------------------------------------------------
+    template <typename T>
+    Uniform<T> handle(const char* name) const
+    {
+        const ShaderVariable* v = uniform(name);
+        if (!v)
+            return Uniform<T>();
+        if (v->type != GL_NONE && !UniformSetter<T>::accepts(v->type)) {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH " << name << " is GL type 0x" << std::hex << v->type << std::dec << std::endl;
+            return Uniform<T>();
+        }
+        return Uniform<T>(v->location);
+    }
+
+private:
+    unsigned int program;
+    std::vector<int> uniformIndex, attributeIndex; // slot -> variable, -1 if empty
+    // uniform names not in the index, as GL resolved them (location -1 if
+    // it does not know them either)
+    mutable std::unordered_map<std::string, ShaderVariable> resolved;
+
+    // an array element or other name GL accepts but does not report: one
+    // glGetUniformLocation, then kept. Its type and size come from the
+    // reported array when the name ends in an index, and are otherwise
+    // unknown (GL_NONE).
+    const ShaderVariable* resolve(const char* name) const
+    {
+        if (!program)
+            return NULL;
+        auto found = resolved.find(name);
+        if (found == resolved.end()) {
+            ShaderVariable v;
+            v.name = name;
+            v.location = glGetUniformLocation(program, name);
+            v.type = GL_NONE;
+            v.size = 1;
+            size_t length = v.name.size();
+            size_t bracket = v.name.rfind('[');
+            if (v.location >= 0 && length > 0 && v.name[length - 1] == ']' && bracket != std::string::npos) {
+                const ShaderVariable* array = find(uniforms, uniformIndex, (v.name.substr(0, bracket) + "[0]").c_str());
+                if (array)
+                    v.type = array->type;
+            }
+            found = resolved.emplace(v.name, v).first;
+        }
+        return found->second.location >= 0 ? &found->second : NULL;
+    }
+    // the length of name without a trailing "[0]"; arrays are indexed
+    // under both forms
+    static size_t arrayBaseLength(const std::string& name)
+    {
+        size_t length = name.size();
+        return length > 3 && name.compare(length - 3, 3, "[0]") == 0 ? length - 3 : length;
+    }
+    static uint32_t hash(const char* name, size_t length)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < length; i++)
+            h = (h ^ (unsigned char)name[i]) * 16777619u;
+        return h;
+    }
+    static void insert(std::vector<int>& index, uint32_t h, int variable)
+    {
+        size_t slot = h & (index.size() - 1);
+        while (index[slot] >= 0)
+            slot = (slot + 1) & (index.size() - 1);
+        index[slot] = variable;
+    }
+    // a power of two at least twice the entries (up to two per variable),
+    // so probes stay short
+    static void buildIndex(const std::vector<ShaderVariable>& variables, std::vector<int>& index)
+    {
+        size_t slots = 8;
+        while (slots < variables.size() * 4)
+            slots *= 2;
+        index.assign(slots, -1);
+        for (size_t i = 0; i < variables.size(); i++) {
+            const std::string& name = variables[i].name;
+            insert(index, hash(name.c_str(), name.size()), (int)i);
+            size_t base = arrayBaseLength(name);
+            if (base != name.size())
+                insert(index, hash(name.c_str(), base), (int)i);
+        }
+    }
+    static const ShaderVariable* find(const std::vector<ShaderVariable>& variables, const std::vector<int>& index, const char* name)
+    {
+        if (index.empty())
+            return NULL;
+        size_t length = strlen(name);
+        size_t mask = index.size() - 1;
+        for (size_t slot = hash(name, length) & mask; index[slot] >= 0; slot = (slot + 1) & mask) {
+            const std::string& candidate = variables[index[slot]].name;
+            if (candidate == name || (arrayBaseLength(candidate) == length && candidate.compare(0, length, name) == 0))
+                return &variables[index[slot]];
+        }
+        return NULL;
+    }
+};
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include "glad.h"
+#include "shader_reflection.h"
+#include "parallel_shader_compile.h"
+#include "shader_source.h"
+#include "program_cache.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+class Shader
+{
+public:
+    unsigned int ID;
+    mutable ShaderReflection reflection; // active uniforms and attributes, read once linked
+    // constructor takes the linked program from ProgramCache::current when
+    // it holds these sources, or else submits the shader to the driver and
+    // returns without waiting for it; the compile and link are checked by
+    // wait() (or the first use()), so several shaders can build while other
+    // assets load. reload() goes through the cache the same way.
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath) : vertexPath(vertexPath), fragmentPath(fragmentPath)
+    {
+        submit(current);
+        ID = current.program;
+        dependOn(current);
+    }
+    // true once wait() would not block: the driver reports the link done
+    // (KHR_parallel_shader_compile), or has no way to tell
+    // ------------------------------------------------------------------------
+    bool ready() const
+    {
+        return !current.pending || programBuildFinished(ID);
+    }
+    // reports compile and link errors and reads the program's interface
+    // ------------------------------------------------------------------------
+    void wait() const
+    {
+        if (!current.pending)
+            return;
+        check(current);
+        reflection.reflect(ID);
+        release(current);
+    }
+    // activate the shader
+    // ------------------------------------------------------------------------
+    void use() const
+    {
+        wait();
+        glUseProgram(ID);
+    }
+    // a pre-resolved, typed uniform for hot paths: look it up once, then
+    // handle.set(value) while the shader is in use
+    // ------------------------------------------------------------------------
+    template <typename T>
+    Uniform<T> uniform(const char* name) const
+    {
+        wait();
+        return reflection.handle<T>(name);
+    }
+    // every file the program was built from, and those its latest rebuild
+    // read; an edit to any of them calls for a reload()
+    // ------------------------------------------------------------------------
+    const std::vector<std::string>& files() const
+    {
+        return dependencies;
+    }
+    // builds the program again from the files on disk, without waiting;
+    // the current program stays in use until finishReload() swaps the new
+    // one in. A rebuild still in flight is dropped for the new one.
+    // ------------------------------------------------------------------------
+    void reload()
+    {
+        if (rebuild.program) {
+            release(rebuild);
+            glDeleteProgram(rebuild.program);
+        }
+        submit(rebuild);
+        dependOn(rebuild);
+    }
+    // ------------------------------------------------------------------------
+    bool reloading() const
+    {
+        return rebuild.program != 0;
+    }
+    // call between frames. Once the driver has finished a rebuild, swaps
+    // it in, re-reads the interface and returns true: Uniform handles must
+    // then be taken again, and uniforms set only once (samplers) set again.
+    // A rebuild that failed is reported and dropped, and the current
+    // program stays. Only with KHR_parallel_shader_compile does this skip
+    // a rebuild still compiling; without it the status check waits for
+    // the compile and link, so call this a while after reload() to give
+    // drivers that compile in the background the time to finish.
+    // ------------------------------------------------------------------------
+    bool finishReload()
+    {
+        if (!rebuild.program || !programBuildFinished(rebuild.program))
+            return false;
+        wait(); // the current program's own checks, if nothing asked for them yet
+        bool built = check(rebuild);
+        release(rebuild);
+        if (!built) {
+            std::cout << "ERROR::SHADER::RELOAD_FAILED " << vertexPath << " + " << fragmentPath << ", keeping the previous program" << std::endl;
+            glDeleteProgram(rebuild.program);
+            rebuild = Build();
+            return false;
+        }
+        glDeleteProgram(ID);
+        current = rebuild;
+        rebuild = Build();
+        ID = current.program;
+        reflection.reflect(ID);
+        dependencies.clear();
+        dependOn(current);
+        return true;
+    }
+    // utility uniform functions, by name through the reflection table
+    // ------------------------------------------------------------------------
+    void setBool(const char* name, bool value) const
+    {         
+        glUniform1i(reflection.uniformLocation(name), (int)value); 
+    }
+    void setBool(const std::string &name, bool value) const
+    {
+        setBool(name.c_str(), value);
+    }
+    // ------------------------------------------------------------------------
+    void setInt(const char* name, int value) const
+    { 
+        glUniform1i(reflection.uniformLocation(name), value); 
+    }
+    void setInt(const std::string &name, int value) const
+    {
+        setInt(name.c_str(), value);
+    }
+    // ------------------------------------------------------------------------
+    void setFloat(const char* name, float value) const
+    { 
+        glUniform1f(reflection.uniformLocation(name), value); 
+    }
+    void setFloat(const std::string &name, float value) const
+    {
+        setFloat(name.c_str(), value);
+    }
+
+private:
+    // one compile and link, or one program loaded from the binary cache
+    // (vertex and fragment 0); pending until checked and released
+    struct Build {
+        unsigned int program, vertex, fragment;
+        std::vector<std::string> vertexFiles, fragmentFiles; // source string n of each stage
+        bool complete; // every file was read
+        bool pending;
+        ProgramCache* cache; // stores the binary once it checks out
+        uint64_t key;        // its key there
+
+        Build() : program(0), vertex(0), fragment(0), complete(true), pending(false), cache(NULL), key(0) {}
+    };
+    std::string vertexPath, fragmentPath;
+    mutable Build current; // ID, until wait() has checked it
+    Build rebuild; // in flight after reload()
+    std::vector<std::string> dependencies;
+
+    void submit(Build& build)
+    {
+        // 1. read the vertex/fragment source files and resolve their #includes;
+        // the pieces go to the driver as they are, without being copied
+        ShaderSource vertexSource, fragmentSource;
+        build.complete = shaderSources().load(vertexPath.c_str(), vertexSource);
+        build.complete = shaderSources().load(fragmentPath.c_str(), fragmentSource) && build.complete;
+        build.vertexFiles = vertexSource.files;
+        build.fragmentFiles = fragmentSource.files;
+        build.pending = true;
+        // 2. take the linked program from the binary cache if it has these sources
+        build.cache = build.complete ? ProgramCache::current : NULL;
+        if (build.cache) {
+            const ShaderSource* stages[2] = { &vertexSource, &fragmentSource };
+            build.key = build.cache->key(stages, 2);
+            build.program = build.cache->load(build.key);
+            if (build.program)
+                return;
+        }
+        // 3. compile shaders
+        // vertex shader
+        build.vertex = glCreateShader(GL_VERTEX_SHADER);
+        vertexSource.upload(build.vertex);
+        glCompileShader(build.vertex);
+        // fragment Shader
+        build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        fragmentSource.upload(build.fragment);
+        glCompileShader(build.fragment);
+        // shader Program
+        build.program = glCreateProgram();
+        if (build.cache)
+            build.cache->prepare(build.program);
+        glAttachShader(build.program, build.vertex);
+        glAttachShader(build.program, build.fragment);
+        glLinkProgram(build.program);
+    }
+    // reports errors; a program that links is stored in the binary cache
+    bool check(const Build& build) const
+    {
+        if (!build.vertex)
+            return true; // loaded from the cache, linked when it was stored
+        bool vertexCompiled = checkCompileErrors(build.vertex, "VERTEX", build.vertexFiles);
+        bool fragmentCompiled = checkCompileErrors(build.fragment, "FRAGMENT", build.fragmentFiles);
+        bool built = checkCompileErrors(build.program, "PROGRAM") && vertexCompiled && fragmentCompiled && build.complete;
+        if (built && build.cache)
+            build.cache->store(build.key, build.program);
+        return built;
+    }
+    // delete the shaders as they're linked into our program now and no longer necessary
+    static void release(Build& build)
+    {
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+        build.vertex = build.fragment = 0;
+        build.pending = false;
+    }
+    // the stage files themselves count even while they cannot be read
+    void dependOn(const Build& build)
+    {
+        std::vector<std::string> added = { ShaderSourceCache::normalize(vertexPath), ShaderSourceCache::normalize(fragmentPath) };
+        for (const std::vector<std::string>* files : { &build.vertexFiles, &build.fragmentFiles })
+            added.insert(added.end(), files->begin(), files->end());
+        for (const std::string& file : added)
+            if (std::find(dependencies.begin(), dependencies.end(), file) == dependencies.end())
+                dependencies.push_back(file);
+    }
+
+    // utility function for checking shader compilation/linking errors.
+    // ------------------------------------------------------------------------
+    static bool checkCompileErrors(unsigned int shader, std::string type, const std::vector<std::string>& files = std::vector<std::string>())
+    {
+        int success;
+        char infoLog[1024];
+        if (type != "PROGRAM")
+        {
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                for (size_t i = 0; i < files.size(); i++)
+                    std::cout << "  source string " << i << ": " << files[i] << std::endl;
+            }
+        }
+        else
+        {
+            glGetProgramiv(shader, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+                std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+            }
+        }
+        return success;
+    }
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,240 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include "glad.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <iostream>
+
+// A whole file read into memory. Files being hot-reloaded can be rewritten
+// or truncated by an editor at any time, which a memory mapping would turn
+// into SIGBUS, so the bytes are copied out with one ordinary read: a file
+// cut short mid-read just comes back short. An empty file is valid.
+class SourceFile
+{
+public:
+    std::string text;
+    bool valid; // the file could be opened and read
+
+    explicit SourceFile(const char* path) : valid(false)
+    {
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(path, error))
+            return;
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return;
+        text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        valid = !file.bad();
+        if (!valid)
+            text.clear();
+    }
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+};
+
+// One shader stage's GLSL as the list of strings glShaderSource takes:
+// spans of cached files between #include lines, and the #line directives
+// that keep compiler messages pointing at the right file and line. Source
+// string n in those messages is files[n]. The spans point into the
+// ShaderSourceCache that produced them and are valid while it holds the
+// files, which is at least until the next invalidate() or clear().
+struct ShaderSource {
+    std::vector<std::string> files; // the stage's own file first, then each #include
+    bool complete;                  // every file was found
+
+    ShaderSource() : complete(true) {}
+
+    // hands every piece to the driver, which copies them; no concatenation
+    // ------------------------------------------------------------------------
+    void upload(unsigned int shader) const
+    {
+        std::vector<const GLchar*> strings;
+        std::vector<GLint> lengths;
+        strings.reserve(pieces.size());
+        lengths.reserve(pieces.size());
+        forEachPiece([&](const char* text, GLint length) {
+            strings.push_back(text);
+            lengths.push_back(length);
+        });
+        glShaderSource(shader, (GLsizei)pieces.size(), strings.data(), lengths.data());
+    }
+    // calls visit(text, length) for every piece in order, where it lies (e.g.
+    // to hash the stage as the driver sees it without joining it first)
+    // ------------------------------------------------------------------------
+    template <typename Visit>
+    void forEachPiece(Visit visit) const
+    {
+        for (const Piece& piece : pieces) {
+            if (piece.directive >= 0)
+                visit(directives[piece.directive].c_str(), (GLint)directives[piece.directive].size());
+            else
+                visit(piece.text, piece.length);
+        }
+    }
+
+private:
+    friend class ShaderSourceCache;
+
+    // a span of a cached file, or one of the generated directives (by index,
+    // so copying a ShaderSource never leaves a pointer into the old copy)
+    struct Piece {
+        const char* text;
+        GLint length;
+        int directive;
+    };
+    std::vector<Piece> pieces;
+    std::vector<std::string> directives;
+
+    void span(const char* begin, const char* end)
+    {
+        if (end > begin)
+            pieces.push_back({ begin, (GLint)(end - begin), -1 });
+    }
+    void directive(const std::string& text)
+    {
+        pieces.push_back({ NULL, 0, (int)directives.size() });
+        directives.push_back(text);
+    }
+};
+
+// Reads shader files on first use and keeps them, so a snippet that many
+// shaders #include is read from disk once. load() resolves
+//
+//     #include "relative/to/the/including/file.glsl"
+//
+// on a line of its own, recursively. A file is included at most once per
+// stage (later #includes of it, and include cycles, are dropped), so
+// shared snippets need no include guards.
+class ShaderSourceCache
+{
+public:
+    int loaded; // files read from disk
+    int reused; // loads and #includes served by a file already read
+
+    ShaderSourceCache() : loaded(0), reused(0) {}
+
+    // builds the pieces of one stage from its file; false (after printing
+    // which) if it or anything it includes could not be read
+    // ------------------------------------------------------------------------
+    bool load(const char* path, ShaderSource& source)
+    {
+        source = ShaderSource();
+        append(normalize(path), source);
+        return source.complete;
+    }
+    // forgets a file, so the next load reads it again; sources built from it
+    // before are no longer valid
+    // ------------------------------------------------------------------------
+    void invalidate(const char* path)
+    {
+        files.erase(normalize(path));
+    }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        files.clear();
+    }
+
+    // the form every path above is kept and reported in
+    // ------------------------------------------------------------------------
+    static std::string normalize(const std::filesystem::path& path)
+    {
+        return path.lexically_normal().generic_string();
+    }
+
+private:
+    std::unordered_map<std::string, std::unique_ptr<SourceFile>> files;
+
+    // NULL if the file cannot be read; a missing file is not remembered,
+    // so creating it later works
+    const SourceFile* file(const std::string& path)
+    {
+        auto found = files.find(path);
+        if (found != files.end()) {
+            reused++;
+            return found->second.get();
+        }
+        std::unique_ptr<SourceFile> sourceFile(new SourceFile(path.c_str()));
+        if (!sourceFile->valid)
+            return NULL;
+        loaded++;
+        return (files[path] = std::move(sourceFile)).get();
+    }
+
+    void append(const std::string& path, ShaderSource& source)
+    {
+        const SourceFile* sourceFile = file(path);
+        if (!sourceFile) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            source.complete = false;
+            return;
+        }
+        int index = (int)source.files.size();
+        source.files.push_back(path);
+        // the first file starts with #version, which nothing may precede
+        if (index > 0)
+            source.directive("#line 1 " + std::to_string(index) + "\n");
+
+        const char* end = sourceFile->text.data() + sourceFile->text.size();
+        const char* piece = sourceFile->text.data();
+        int line = 1;
+        for (const char* p = sourceFile->text.data(); p < end; line++) {
+            const char* newline = (const char*)memchr(p, '\n', end - p);
+            const char* next = newline ? newline + 1 : end;
+            std::string name;
+            if (includeName(p, next, name)) {
+                source.span(piece, p);
+                std::string included = normalize(std::filesystem::path(path).parent_path() / name);
+                if (std::find(source.files.begin(), source.files.end(), included) == source.files.end())
+                    append(included, source);
+                // back in this file, on the line after the #include
+                source.directive("\n#line " + std::to_string(line + 1) + " " + std::to_string(index) + "\n");
+                piece = next;
+            }
+            p = next;
+        }
+        source.span(piece, end);
+    }
+
+    // true for a line of the form:  #include "name"
+    static bool includeName(const char* p, const char* end, std::string& name)
+    {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p == end || *p++ != '#')
+            return false;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (end - p < 8 || strncmp(p, "include", 7) != 0)
+            return false;
+        p += 7;
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p == end || *p++ != '"')
+            return false;
+        const char* close = (const char*)memchr(p, '"', end - p);
+        if (!close || close == p)
+            return false;
+        name.assign(p, close);
+        return true;
+    }
+};
+
+// the cache every Shader loads through
+inline ShaderSourceCache& shaderSources()
+{
+    static ShaderSourceCache cache;
+    return cache;
+}
+
+#endif
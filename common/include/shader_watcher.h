@@ -0,0 +1,250 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+// class Shader comes from shader_m.h or shader_s.h, whichever the demo uses
+#ifndef SHADER_H
+#error "include shader_m.h or shader_s.h before shader_watcher.h"
+#endif
+
+#include "shader_source.h"
+#include "parallel_shader_compile.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+#include <filesystem>
+#include <iostream>
+
+// Hot reload for Shader. A background thread blocks on Linux inotify,
+// watching the directories of every file the watched shaders were built
+// from (directories, not files, because editors usually save by renaming
+// a new file over the old one), and queues the paths written or moved in.
+// update(), called by the render thread between frames, drops those files
+// from the source cache, calls reload() on each shader that read one of
+// them, and swaps in every rebuild the driver has finished. A rebuild that
+// fails leaves the old program running.
+//
+// With KHR_parallel_shader_compile nothing on the render thread waits for
+// a compile: a rebuild that is not done yet is looked at again next frame.
+// Without it the driver cannot say when a rebuild is done, and asking
+// waits for its compile and link. update() then rebuilds one shader at a
+// time and keeps the old program for interval seconds before asking, which
+// is long enough for drivers that compile on their own threads anyway; on
+// others the render thread still waits. Either way every swap is timed,
+// and one that held up the frame for more than stallWarningMs is reported.
+//
+// Elsewhere than Linux the watcher does nothing.
+class ShaderWatcher
+{
+public:
+    bool available; // inotify is running
+    int reloads;    // programs swapped in
+    int failures;   // rebuilds that failed and were dropped
+    double interval; // seconds a rebuild is left alone without KHR_parallel_shader_compile
+    double stallMs;  // how long the last swap kept the render thread waiting
+    double worstStallMs;
+    double stallWarningMs;
+
+    ShaderWatcher()
+        : available(false), reloads(0), failures(0), interval(0.25), stallMs(0.0), worstStallMs(0.0), stallWarningMs(2.0),
+          settled(0.0)
+    {
+#ifdef __linux__
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        wakeFds[0] = wakeFds[1] = -1;
+        if (inotifyFd < 0 || pipe(wakeFds) != 0) {
+            std::cout << "ERROR::SHADER_WATCHER::INOTIFY_UNAVAILABLE" << std::endl;
+            return;
+        }
+        available = true;
+        thread = std::thread(&ShaderWatcher::run, this);
+#endif
+    }
+
+    ~ShaderWatcher()
+    {
+#ifdef __linux__
+        if (thread.joinable()) {
+            char stop = 0;
+            if (write(wakeFds[1], &stop, 1) == 1)
+                thread.join();
+            else
+                thread.detach();
+        }
+        if (inotifyFd >= 0)
+            close(inotifyFd);
+        if (wakeFds[0] >= 0) {
+            close(wakeFds[0]);
+            close(wakeFds[1]);
+        }
+#endif
+    }
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // reloads the shader whenever one of its files changes; it must outlive
+    // the watcher or be unwatched first
+    // ------------------------------------------------------------------------
+    void watch(Shader& shader)
+    {
+        if (std::find(shaders.begin(), shaders.end(), &shader) == shaders.end())
+            shaders.push_back(&shader);
+        watchDirectories(shader);
+    }
+    // ------------------------------------------------------------------------
+    void unwatch(Shader& shader)
+    {
+        shaders.erase(std::remove(shaders.begin(), shaders.end(), &shader), shaders.end());
+        queued.erase(std::remove(queued.begin(), queued.end(), &shader), queued.end());
+    }
+    // call once per frame on the render thread, before drawing; returns how
+    // many shaders got a new program, whose Uniform handles must be taken
+    // again
+    // ------------------------------------------------------------------------
+    int update()
+    {
+        std::vector<std::string> paths;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            paths.swap(changed);
+        }
+        std::sort(paths.begin(), paths.end());
+        paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+        for (const std::string& path : paths)
+            shaderSources().invalidate(path.c_str());
+        for (Shader* shader : shaders)
+            if (dependsOn(*shader, paths) && std::find(queued.begin(), queued.end(), shader) == queued.end())
+                queued.push_back(shader);
+
+        if (ParallelShaderCompile::available) {
+            for (Shader* shader : queued)
+                shader->reload();
+            queued.clear();
+        } else {
+            bool building = std::any_of(shaders.begin(), shaders.end(), [](Shader* shader) { return shader->reloading(); });
+            if (!building && !queued.empty()) {
+                queued.front()->reload();
+                queued.erase(queued.begin());
+                settled = seconds() + interval;
+            }
+            if (seconds() < settled)
+                return 0; // give the driver time before asking
+        }
+
+        int swapped = 0;
+        for (Shader* shader : shaders) {
+            if (!shader->reloading())
+                continue;
+            double start = seconds();
+            bool finished = shader->finishReload();
+            double waited = (seconds() - start) * 1000.0;
+            if (finished || !shader->reloading()) {
+                stallMs = waited;
+                worstStallMs = std::max(worstStallMs, waited);
+                if (waited > stallWarningMs)
+                    std::cout << "WARNING::SHADER_WATCHER::RELOAD_STALL " << shader->files().front() << " held the frame for "
+                              << waited << " ms" << std::endl;
+            }
+            if (finished)
+                swapped++;
+            else if (!shader->reloading())
+                failures++;
+            else
+                continue; // still compiling
+            watchDirectories(*shader); // a new #include may live somewhere new
+        }
+        reloads += swapped;
+        return swapped;
+    }
+
+private:
+    std::vector<Shader*> shaders;   // render thread only
+    std::vector<Shader*> queued;    // to rebuild, oldest first
+    double settled;                 // without the extension, when the rebuild in flight may be asked about
+    std::mutex mutex;               // guards the two below
+    std::vector<std::string> changed;
+    std::unordered_map<int, std::string> directories; // inotify watch -> directory
+#ifdef __linux__
+    int inotifyFd;
+    int wakeFds[2]; // written to stop the thread
+    std::thread thread;
+#endif
+
+    static double seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static bool dependsOn(const Shader& shader, const std::vector<std::string>& paths)
+    {
+        for (const std::string& file : shader.files())
+            if (std::binary_search(paths.begin(), paths.end(), file))
+                return true;
+        return false;
+    }
+
+    void watchDirectories(const Shader& shader)
+    {
+#ifdef __linux__
+        if (!available)
+            return;
+        for (const std::string& file : shader.files()) {
+            std::string directory = std::filesystem::path(file).parent_path().generic_string();
+            if (directory.empty())
+                directory = ".";
+            // the same directory always gets the same watch back
+            int watch = inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (watch < 0)
+                continue; // not there (yet); the shader's next change of files retries
+            std::lock_guard<std::mutex> lock(mutex);
+            directories[watch] = directory;
+        }
+#else
+        (void)shader;
+#endif
+    }
+
+#ifdef __linux__
+    // the watcher thread: sleeps in poll() until inotify has events or the
+    // destructor asks it to stop, and only ever touches the queue
+    void run()
+    {
+        alignas(struct inotify_event) char buffer[4096];
+        pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { wakeFds[0], POLLIN, 0 } };
+        for (;;) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                return;
+            }
+            if (fds[1].revents)
+                return;
+            ssize_t length;
+            while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (char* p = buffer; p < buffer + length; ) {
+                    const struct inotify_event* event = (const struct inotify_event*)p;
+                    auto directory = directories.find(event->wd);
+                    if (event->len > 0 && directory != directories.end())
+                        changed.push_back(ShaderSourceCache::normalize(std::filesystem::path(directory->second) / event->name));
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        }
+    }
+#endif
+};
+
+#endif